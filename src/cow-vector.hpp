@@ -0,0 +1,195 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace json {
+// std::vector like container whose copies share the storage until one of them is modified
+// const member functions never touch the storage, non-const ones detach it first
+// once a non-const function hands out a reference or an iterator, the storage is no longer shared,
+// so a later copy gets its own storage and modifications through the reference do not leak into it
+// iterators obtained before copying the container are invalidated by the next modification
+template <class T>
+class CowVector {
+  private:
+    using Storage = std::vector<T>;
+
+    std::shared_ptr<Storage> storage;        // null while empty
+    bool                     leaked = false; // a mutable reference into storage may exist
+
+    auto get() const -> const Storage& {
+        static const auto empty = Storage();
+        return storage ? *storage : empty;
+    }
+
+    auto mut() -> Storage& {
+        if(!storage) {
+            storage = std::make_shared<Storage>();
+        } else if(storage.use_count() != 1) {
+            storage = std::make_shared<Storage>(*storage);
+        } else {
+            // pairs with the release by the last other owner, so its reads happen before our writes
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *storage;
+    }
+
+    // for functions which hand out references or iterators
+    auto leak() -> Storage& {
+        auto& ret = mut();
+        leaked    = true;
+        return ret;
+    }
+
+    static auto share(const CowVector& other) -> std::shared_ptr<Storage> {
+        return other.leaked ? std::make_shared<Storage>(*other.storage) : other.storage;
+    }
+
+  public:
+    using value_type     = T;
+    using size_type      = typename Storage::size_type;
+    using iterator       = typename Storage::iterator;
+    using const_iterator = typename Storage::const_iterator;
+
+    // const access
+    auto begin() const -> const_iterator {
+        return get().begin();
+    }
+
+    auto end() const -> const_iterator {
+        return get().end();
+    }
+
+    auto size() const -> size_type {
+        return get().size();
+    }
+
+    auto empty() const -> bool {
+        return get().empty();
+    }
+
+    auto data() const -> const T* {
+        return get().data();
+    }
+
+    auto operator[](const size_type index) const -> const T& {
+        return get()[index];
+    }
+
+    auto front() const -> const T& {
+        return get().front();
+    }
+
+    auto back() const -> const T& {
+        return get().back();
+    }
+
+    // mutable access
+    auto begin() -> iterator {
+        return leak().begin();
+    }
+
+    auto end() -> iterator {
+        return leak().end();
+    }
+
+    auto data() -> T* {
+        return leak().data();
+    }
+
+    auto operator[](const size_type index) -> T& {
+        return leak()[index];
+    }
+
+    auto front() -> T& {
+        return leak().front();
+    }
+
+    auto back() -> T& {
+        return leak().back();
+    }
+
+    auto push_back(T value) -> void {
+        mut().push_back(std::move(value));
+    }
+
+    template <class... Args>
+    auto emplace_back(Args&&... args) -> T& {
+        return leak().emplace_back(std::forward<Args>(args)...);
+    }
+
+    auto pop_back() -> void {
+        mut().pop_back();
+    }
+
+    // pos must be obtained from this container after the last copy
+    auto insert(const const_iterator pos, T value) -> iterator {
+        return leak().insert(pos, std::move(value));
+    }
+
+    template <class Iterator>
+    auto insert(const const_iterator pos, const Iterator first, const Iterator last) -> iterator {
+        return leak().insert(pos, first, last);
+    }
+
+    auto erase(const const_iterator pos) -> iterator {
+        return leak().erase(pos);
+    }
+
+    auto erase(const const_iterator first, const const_iterator last) -> iterator {
+        return leak().erase(first, last);
+    }
+
+    auto reserve(const size_type size) -> void {
+        mut().reserve(size);
+    }
+
+    auto resize(const size_type size) -> void {
+        mut().resize(size);
+    }
+
+    auto clear() -> void {
+        storage.reset();
+        leaked = false;
+    }
+
+    // true if both share the same storage
+    auto shares_with(const CowVector& other) const -> bool {
+        return storage == other.storage;
+    }
+
+    auto operator==(const CowVector& other) const -> bool {
+        return storage == other.storage || get() == other.get();
+    }
+
+    CowVector() = default;
+
+    CowVector(const CowVector& other)
+        : storage(share(other)) {
+    }
+
+    CowVector(CowVector&& other) noexcept
+        : storage(std::move(other.storage)),
+          leaked(std::exchange(other.leaked, false)) {
+    }
+
+    auto operator=(const CowVector& other) -> CowVector& {
+        if(this != &other) {
+            storage = share(other);
+            leaked  = false;
+        }
+        return *this;
+    }
+
+    auto operator=(CowVector&& other) noexcept -> CowVector& {
+        storage = std::move(other.storage);
+        leaked  = std::exchange(other.leaked, false);
+        return *this;
+    }
+
+    CowVector(Storage vector)
+        : storage(vector.empty() ? nullptr : std::make_shared<Storage>(std::move(vector))) {
+    }
+};
+} // namespace json
@@ -1,9 +1,20 @@
 #include <array>
+#include <atomic>
+#include <cstring>
+#include <format>
+#include <span>
+#include <thread>
+#include <utility>
 
+#include "deparser.hpp"
+#include "document.hpp"
 #include "json.hpp"
 #include "lexer.hpp"
 #include "macros/assert.hpp"
 #include "macros/unwrap.hpp"
+#include "reader.hpp"
+#include "schema.hpp"
+#include "snapshot.hpp"
 
 namespace json {
 namespace {
@@ -45,96 +56,6 @@ namespace {
     }
 }
 
-auto print_object(const Object& o, int indent) -> void;
-
-auto print_value(const Value& value, int indent) -> void {
-    const auto prefix = std::string(indent, ' ');
-    switch(value.get_index()) {
-    case Value::index_of<Number>:
-        std::print("{}", value.as<Number>().value);
-        break;
-    case Value::index_of<String>:
-        std::print(R"("{}")", value.as<String>().value);
-        break;
-    case Value::index_of<Boolean>:
-        std::print("{}", value.as<Boolean>().value ? "true" : "false");
-        break;
-    case Value::index_of<Null>:
-        std::print("null");
-        break;
-    case Value::index_of<Array>:
-        std::print("[");
-        for(const auto& e : value.as<Array>().value) {
-            print_value(e, indent);
-            std::print(",");
-        }
-        std::print("]");
-        break;
-    case Value::index_of<Object>:
-        print_object(value.as<Object>(), indent);
-        break;
-    }
-}
-
-auto print_object(const Object& o, const int indent) -> void {
-    const auto prefix1 = std::string(indent, ' ');
-    const auto prefix2 = std::string(indent + 4, ' ');
-    std::println("{{");
-    const auto& c = o.children;
-    for(auto i = c.begin(); i != c.end(); i = std::next(i)) {
-        const auto& [key, value] = *i;
-        std::print(R"({}"{}": )", prefix2, key);
-        print_value(value, indent + 4);
-        std::println(",");
-    }
-    std::print("{}}}", prefix1);
-}
-
-auto operator==(const Array& a, const Array& b) -> bool;
-auto operator==(const Object& a, const Object& b) -> bool;
-
-auto operator==(const Value& a, const Value& b) -> bool {
-    ensure(a.get_index() == b.get_index());
-
-    switch(a.get_index()) {
-    case Value::index_of<Number>:
-        return a.as<Number>().value == b.as<Number>().value;
-    case Value::index_of<String>:
-        return a.as<String>().value == b.as<String>().value;
-    case Value::index_of<Boolean>:
-        return a.as<Boolean>().value == b.as<Boolean>().value;
-    case Value::index_of<Null>:
-        return true;
-    case Value::index_of<Array>:
-        return a.as<Array>() == b.as<Array>();
-    case Value::index_of<Object>:
-        return a.as<Object>() == b.as<Object>();
-    }
-    return false;
-}
-
-auto operator==(const Array& a, const Array& b) -> bool {
-    const auto& v1 = a.value;
-    const auto& v2 = b.value;
-    ensure(v1.size() == v2.size());
-    for(auto i = 0u; i < v1.size(); i += 1) {
-        ensure(v1[i] == v2[i]);
-    }
-    return true;
-}
-
-auto operator==(const Object& a, const Object& b) -> bool {
-    const auto& x = a.children;
-    const auto& y = b.children;
-    ensure(x.size() == y.size());
-    for(auto i = 0u; i < x.size(); i += 1) {
-        const auto vy = b.find(x[i].key);
-        ensure(vy);
-        ensure(x[i].value == *vy);
-    }
-    return true;
-}
-
 struct TestCase {
     Object      object;
     std::string string;
@@ -226,6 +147,24 @@ const auto string_test = TestCase{
     })",
 };
 
+// escape test
+const auto escape_test = TestCase{
+    .object = make_object(
+        "control", String("a\nb\tc\r\b\f"),
+        "solidus", String("/"),
+        "unicode", String("\u00e9\u3042"),
+        "surrogate", String("\U0001F600"),
+        "raw", String("\u00e9\u3042")),
+    .string = R"(
+    {
+        "control": "a\nb\tc\r\b\f",
+        "solidus": "\/",
+        "unicode": "\u00e9\u3042",
+        "surrogate": "\ud83d\ude00",
+        "raw": "éあ"
+    })",
+};
+
 // comment test
 const auto comment_test = TestCase{
     .object = make_object(
@@ -264,6 +203,408 @@ const auto trailing_comma_test = TestCase{
     })",
 };
 
+// strings which must be rejected
+const auto invalid_strings = std::array{
+    R"({"a": "\x"})",
+    R"({"a": "\u12"})",
+    R"({"a": "\ud83d"})",
+    R"({"a": "\ude00"})",
+    R"({"a": "\ud83d\u0041"})",
+    "{\"a\": \"\xc3\x28\"}",
+    "{\"a\": \"\xe0\x80\x80\"}",
+    "{\"a\": \"\xed\xa0\x80\"}",
+    "{\"a\": \"\xf4\x90\x80\x80\"}",
+    R"({"a": "unterminated})",
+};
+
+// concatenated values for Reader
+const auto stream_values = std::array{
+    Value::create<Array>(make_array(Number(1), Number(2))),
+    Value::create<Object>(make_object("a", Number(1))),
+    Value::create<String>("str"),
+    Value::create<Number>(3.0),
+    Value::create<Boolean>(true),
+    Value::create<Null>(),
+    Value::create<Array>(),
+};
+const auto stream_string = R"([1,2]{"a":1} "str"
+3 true/*comment*/null
+[] )";
+
+// documents with trailing data
+const auto trailing_data_strings = std::array{
+    R"({"a": 1} x)",
+    R"({} {})",
+    R"({"a": 1}})",
+};
+
+auto test_reader() -> bool {
+    auto reader = Reader{.str = stream_string};
+    for(const auto& expect : stream_values) {
+        ensure(!reader.is_eof());
+        unwrap(value, reader.read());
+        ensure(value == expect);
+    }
+    ensure(reader.is_eof());
+
+    unwrap(value, parse_value(" \"str\" "));
+    ensure(value == Value::create<String>("str"));
+    unwrap(str, parse_value(deparse(value)));
+    ensure(str == value);
+    unwrap(number, parse_value("-1.5e3"));
+    ensure(number == Value::create<Number>(-1500.0));
+    // the cursor stays where it was on errors
+    auto cursor = size_t(1);
+    ensure(!skip_blank("1 /* unterminated", cursor, true) && cursor == 1);
+    auto numbers = Reader{.str = "1 2"};
+    ensure(numbers.read() == Value::create<Number>(1.0) && numbers.read() == Value::create<Number>(2.0) && numbers.is_eof());
+    for(const auto str : trailing_data_strings) {
+        ensure(!parse(str));
+    }
+    return true;
+}
+
+auto test_equality() -> bool {
+    // key order does not matter
+    unwrap(a, parse(R"({"a": 1, "b": [1, {"c": null}]})"));
+    unwrap(b, parse(R"({"b": [1, {"c": null}], "a": 1})"));
+    ensure(a == b);
+    unwrap(c, parse(R"({"a": 1, "b": [{"c": null}, 1]})"));
+    ensure(!(a == c));
+
+    // duplicated keys are compared in order of appearance
+    unwrap(dup, parse(R"({"a": 1, "b": 2, "a": 3})"));
+    unwrap(reordered, parse(R"({"a": 1, "a": 3, "b": 2})"));
+    unwrap(swapped, parse(R"({"a": 3, "b": 2, "a": 1})"));
+    ensure(dup == dup && dup == reordered);
+    ensure(!(dup == swapped));
+
+    // large objects in different key orders, quadratic lookups would take seconds
+    auto forward  = Object();
+    auto backward = Object();
+    for(auto i = 0; i < 20000; i += 1) {
+        forward.children.push_back({std::format("key{}", i), Value::create<Number>(double(i))});
+        backward.children.push_back({std::format("key{}", 19999 - i), Value::create<Number>(double(19999 - i))});
+    }
+    ensure(forward == backward);
+    ensure(diff(forward, backward).value.empty());
+    return true;
+}
+
+// patch test
+const auto patch_test = std::array{
+    // source, patch, expected result
+    R"({"a": 1, "b": {"c": [1, 2, 3]}, "d~/": "x"})",
+    R"([
+        {"op": "test", "path": "/a", "value": 1},
+        {"op": "replace", "path": "/a", "value": [1]},
+        {"op": "add", "path": "/b/c/1", "value": 9},
+        {"op": "add", "path": "/b/c/-", "value": 4},
+        {"op": "remove", "path": "/b/c/0"},
+        {"op": "copy", "from": "/b/c", "path": "/e"},
+        {"op": "move", "from": "/d~0~1", "path": "/b/d"}
+    ])",
+    R"({"a": [1], "b": {"c": [9, 2, 3, 4], "d": "x"}, "e": [9, 2, 3, 4]})",
+};
+
+auto test_patch(const std::span<const TestCase* const> tests) -> bool {
+    unwrap_mut(object, parse(patch_test[0]));
+    unwrap(patch, parse_value(patch_test[1]));
+    unwrap(expect, parse(patch_test[2]));
+    ensure(apply_patch(object, patch.as<Array>()));
+    ensure(object == expect);
+    ensure(!apply_patch(object, make_array(make_object("op", String("test"), "path", String("/a"), "value", Null()))));
+    ensure(apply_patch(object, make_array(make_object("op", String("move"), "from", String("/a"), "path", String("/a")))));
+    ensure(!apply_patch(object, make_array(make_object("op", String("move"), "from", String("/x"), "path", String("/x")))));
+
+    // diff between every pair of test cases must turn one into the other
+    for(const auto from : tests) {
+        for(const auto to : tests) {
+            auto object = from->object;
+            ensure(apply_patch(object, diff(from->object, to->object)));
+            ensure(object == to->object);
+        }
+    }
+    // array insertion in the middle is a single operation
+    const auto a = make_object("a", make_array(Number(1), Number(2), Number(3)));
+    const auto b = make_object("a", make_array(Number(1), Number(5), Number(2), Number(3)));
+    const auto patch_ab = diff(a, b);
+    ensure(patch_ab.value.size() == 1);
+    return true;
+}
+
+auto test_msgpack(const std::span<const TestCase* const> tests) -> bool {
+    for(const auto test : tests) {
+        const auto bytes = encode_msgpack(test->object);
+        unwrap(decoded, decode_msgpack(bytes));
+        ensure(decoded.as<Object>() == test->object);
+    }
+    // {"a":1,"b":[-1,0.5,300]}
+    const auto expect = std::array<uint8_t, 16>{0x82, 0xa1, 'a', 0x01, 0xa1, 'b', 0x93, 0xff, 0xca, 0x3f, 0x00, 0x00, 0x00, 0xcd, 0x01, 0x2c};
+    const auto bytes  = encode_msgpack(make_object("a", Number(1), "b", make_array(Number(-1), Number(0.5), Number(300))));
+    ensure(bytes.size() == expect.size());
+    ensure(std::memcmp(bytes.data(), expect.data(), bytes.size()) == 0);
+    // trailing data
+    auto trailing = bytes;
+    trailing.push_back(std::byte(0x00));
+    ensure(!decode_msgpack(trailing));
+    return true;
+}
+
+auto test_snapshot(const std::span<const TestCase* const> tests) -> bool {
+    for(const auto test : tests) {
+        const auto image = snapshot::write(test->object);
+        unwrap(root, snapshot::open_image(image));
+        ensure(root.to_object() == test->object);
+        for(const auto& [key, value] : test->object.children) {
+            unwrap(view, root.find(key));
+            ensure(view.to_value() == value);
+        }
+        ensure(!root.find("no such key"));
+    }
+    const auto object = make_object("b", String("x"), "a", make_array(Number(1), String("x")), "c", Boolean(true));
+    const auto image  = snapshot::write(object);
+    unwrap(root, snapshot::open_image(image));
+    ensure(root.key(0) == "a" && root.key(1) == "b" && root.key(2) == "c");
+    unwrap(array, root.find("a"));
+    ensure(array.get_index() == Value::index_of<Array>);
+    ensure(array.as_array()[1].as_string() == "x");
+    ensure(!snapshot::open_image(std::span(image).first(image.size() - 1)));
+    return true;
+}
+
+// formatter test
+constexpr auto pretty_opts = DeparseOpts{.indent = 2, .sort_keys = true, .ascii_only = true};
+constexpr auto fixed_opts  = DeparseOpts{.float_format = FloatFormat::Fixed, .precision = 2};
+
+const auto pretty_object = make_object(
+    "b", make_array(Number(1), Object(), Array(), make_object("x", Null())),
+    "a", String("\u00e9\U0001F600\n"));
+const auto pretty_string = R"({
+  "a": "\u00e9\ud83d\ude00\n",
+  "b": [
+    1,
+    {},
+    [],
+    {
+      "x": null
+    }
+  ]
+})";
+
+auto test_deparser(const std::span<const TestCase* const> tests) -> bool {
+    for(const auto test : tests) {
+        unwrap(parsed, parse(deparse<pretty_opts>(test->object)));
+        ensure(parsed == test->object);
+    }
+    ensure(deparse<pretty_opts>(pretty_object) == pretty_string);
+    ensure(deparse<fixed_opts>(Value::create<Array>(make_array(Number(0.125), Number(1)))) == "[0.12,1.00]");
+
+    // invalid utf-8 is replaced, including surrogates, overlong forms and out of range lead bytes
+    constexpr auto ascii_opts = DeparseOpts{.ascii_only = true};
+    const auto     invalid    = Value::create<String>("a\xed\xa0\x80" "b\xc0\xaf" "c\xf5\x80" "d\xe2\x82");
+    const auto     escaped    = deparse<ascii_opts>(invalid);
+    ensure(escaped == R"("a\ufffd\ufffd\ufffdb\ufffd\ufffdc\ufffd\ufffdd\ufffd\ufffd")");
+    ensure(parse_value(escaped, {.validate_utf8 = true}));
+    ensure(deparse<ascii_opts>(Value::create<String>("\xc3\xa9\xf0\x9f\x98\x80")) == R"("\u00e9\ud83d\ude00")");
+    return true;
+}
+
+auto test_builder() -> bool {
+    // lvalues must not be moved from
+    const auto str    = String("keep");
+    auto       array  = make_array(str, Number(1));
+    auto       object = make_object("a", str, "b", array);
+    ensure(str.value == "keep");
+    ensure(array.value.size() == 2);
+    // object_append replaces existing values, make_object appends without looking keys up
+    auto appended = make_object("a", Null());
+    object_append(appended, "a", Number(1), "b", Null());
+    ensure(appended.children.size() == 2 && appended.find<Number>("a")->value == 1);
+    ensure(make_object("a", Null(), "a", Null()).children.size() == 2);
+
+    array.emplace_back<String>("x");
+    array.emplace_back<Array>().emplace_back<Null>();
+    ensure(array == make_array(str, Number(1), String("x"), make_array(Null())));
+    ensure(array.erase(0) && !array.erase(array.value.size()));
+    ensure(array.value[0] == Value::create<Number>(1.0));
+
+    const auto [value, inserted] = object.try_emplace<Number>("a", 2.0);
+    ensure(!inserted && *value == Value::create<String>("keep"));
+    ensure(object.try_emplace<Number>("c", 2.0).second);
+    object.emplace_back<Boolean>("d", true);
+    ensure(object.erase("b") && !object.erase("b"));
+    ensure(object == make_object("a", str, "c", Number(2), "d", Boolean(true)));
+
+    auto source = make_object("e", String("moved"), "f", Null());
+    object.insert(std::make_move_iterator(source.children.begin()), std::make_move_iterator(source.children.end()));
+    ensure(object.children.size() == 5 && object.find<String>("e")->value == "moved");
+    return true;
+}
+
+auto test_shared_tree() -> bool {
+    const auto base = make_object(
+        "a", make_object("b", Number(1), "c", make_array(Number(1))),
+        "d", make_object("e", Null()));
+    const auto orig = base;
+    auto       copy = base;
+    (*copy.find<Object>("a"))["b"] = Value::create<Number>(2.0);
+    ensure(base == orig);
+    ensure(copy.find<Object>("a")->find<Number>("b")->value == 2.0);
+#if defined(TINYJSON_SHARED_TREE)
+    // only the path to the modified value is copied
+    const auto& a = std::as_const(copy);
+    ensure(!a.children.shares_with(base.children));
+    ensure(!a.find<Object>("a")->children.shares_with(base.find<Object>("a")->children));
+    ensure(a.find<Object>("a")->find<Array>("c")->value.shares_with(base.find<Object>("a")->find<Array>("c")->value));
+    ensure(a.find<Object>("d")->children.shares_with(base.find<Object>("d")->children));
+#endif
+
+    // references taken before copying do not reach the copy
+    auto       source = make_object("a", Number(1), "b", make_array(Number(1)));
+    const auto p      = source.find("a");
+    const auto first  = source.children.begin();
+    const auto copied = source;
+    *p                = Value::create<Number>(2.0);
+    first->key        = "c";
+    ensure(copied == make_object("a", Number(1), "b", make_array(Number(1))));
+    ensure(source == make_object("c", Number(2), "b", make_array(Number(1))));
+#if defined(TINYJSON_SHARED_TREE)
+    // untouched children and parsed trees are still shared
+    ensure(std::as_const(copied).find<Array>("b")->value.shares_with(std::as_const(source).find<Array>("b")->value));
+    unwrap(parsed, parse(R"({"a": [1, {"b": 2}]})"));
+    const auto parsed_copy = parsed;
+    ensure(parsed_copy.children.shares_with(parsed.children));
+#endif
+    return true;
+}
+
+auto test_shared_document() -> bool {
+    auto document = SharedDocument();
+    ensure(!document.load());
+    document.store(make_object("version", Number(0)));
+    const auto old = document.load();
+
+    // readers keep loading while the document is replaced
+    constexpr auto versions = 100;
+    auto           done     = std::atomic_bool(false);
+    auto           readers  = std::vector<std::thread>();
+    auto           errors   = std::atomic_int(0);
+    for(auto i = 0; i < 4; i += 1) {
+        readers.emplace_back([&] {
+            auto last = 0.0;
+            while(!done) {
+                const auto object  = document.load();
+                const auto version = object->find<Number>("version")->value;
+                errors += version < last ? 1 : 0;
+                last = version;
+            }
+        });
+    }
+    for(auto i = 1; i <= versions; i += 1) {
+        document.store(make_object("version", Number(i)));
+    }
+    done = true;
+    for(auto& reader : readers) {
+        reader.join();
+    }
+    ensure(errors == 0);
+    ensure(document.load()->find<Number>("version")->value == versions);
+    // replaced documents stay alive while referenced
+    ensure(old->find<Number>("version")->value == 0);
+    return true;
+}
+
+// schema test
+struct Point {
+    int    x;
+    double y;
+};
+
+struct Shape {
+    std::string                name;
+    std::vector<Point>         points;
+    std::optional<bool>        closed;
+    std::optional<std::string> note;
+    std::optional<int64_t>     id;
+    Value                      extra;
+};
+
+using PointSchema = schema::Schema<Point,
+                                   schema::Field<"x", &Point::x>,
+                                   schema::Field<"y", &Point::y>>;
+using ShapeSchema = schema::Schema<Shape,
+                                   schema::Field<"name", &Shape::name>,
+                                   schema::Field<"points", &Shape::points, PointSchema>,
+                                   schema::Field<"closed", &Shape::closed>,
+                                   schema::Field<"note", &Shape::note>,
+                                   schema::Field<"id", &Shape::id>,
+                                   schema::Field<"extra", &Shape::extra>>;
+
+struct Labeled {
+    Point labeled_point_with_long_name;
+};
+
+using LabeledSchema = schema::Schema<Labeled,
+                                     schema::Field<"labeled_point_with_long_name", &Labeled::labeled_point_with_long_name, PointSchema>>;
+
+const auto schema_string = R"(
+    {
+        "name": "tri\u0061ngle",
+        "points": [{"x": 0, "y": 0}, {"y": 1.5, "x": 1e1}, {"x": -2, "y": 3},],
+        "closed": true,
+        // comment
+        "extra": {"any": [1, "thing"]},
+    })";
+
+const auto invalid_schema_strings = std::array{
+    R"({"name": "a", "points": [], "extra": null, "unknown": 1})",
+    R"({"name": "a", "points": [{"x": 1.5, "y": 0}], "extra": null})",
+    R"({"name": "a", "points": [{"x": "1", "y": 0}], "extra": null})",
+    R"({"name": "a", "points": [{"x": 1}], "extra": null})",
+    R"({"name": "a", "name": "b", "points": [], "extra": null})",
+    R"({"name": "a", "points": null, "extra": null})",
+    R"({"name": "a", "points": [], "extra": null} {})",
+    R"({"name": "a", "points": [], "extra": null, "id": 9223372036854775807.0})",
+    R"({"name": "a", "points": [], "extra": null, "id": 9.223372036854775807e18})",
+    R"({"name": "a", "points": [], "extra": null, "id": -9223372036854777856.0})",
+    "{\"name\": \"a\",\r \"points\": [], \"extra\": null}",
+};
+
+auto test_schema() -> bool {
+    unwrap(shape, schema::parse<ShapeSchema>(schema_string));
+    ensure(schema::parse<ShapeSchema>("{\"name\": \"a\",\r\n\"points\": [], \"extra\": null}"));
+    ensure(shape.name == "triangle");
+    ensure(shape.points.size() == 3);
+    ensure(shape.points[1].x == 10 && shape.points[1].y == 1.5);
+    ensure(shape.points[2].x == -2 && shape.points[2].y == 3);
+    ensure(shape.closed == true);
+    ensure(!shape.note);
+    unwrap(extra, parse(R"({"any": [1, "thing"]})"));
+    ensure(shape.extra == Value::create<Object>(extra));
+
+    // reparsing into the same struct clears optional fields which are missing
+    auto reuse = shape;
+    ensure(schema::parse<ShapeSchema>(R"({"name": "b", "points": [], "closed": null, "note": "x", "extra": 1})", reuse));
+    ensure(reuse.points.empty() && !reuse.closed && reuse.note == "x");
+    ensure(schema::parse<ShapeSchema>(R"({"name": "b", "points": [], "extra": 1})", reuse));
+    ensure(!reuse.note);
+    // the extreme values of int64_t in float forms
+    ensure(schema::parse<ShapeSchema>(R"({"name": "b", "points": [], "extra": 1, "id": 9.2233720368547748e18})", reuse));
+    ensure(reuse.id == 9223372036854774784);
+    ensure(schema::parse<ShapeSchema>(R"({"name": "b", "points": [], "extra": 1, "id": -9.223372036854775808e18})", reuse));
+    ensure(reuse.id == std::numeric_limits<int64_t>::min());
+
+    for(const auto str : invalid_schema_strings) {
+        ensure(!schema::parse<ShapeSchema>(str));
+    }
+
+    // escaped keys in nested structs must not clobber the outer key
+    ensure(schema::parse<LabeledSchema>(R"({"\u006cabeled_point_with_long_name": {"\u0078": 1, "y": 2}})"));
+    ensure(!schema::parse<LabeledSchema>(R"({"\u006cabeled_point_with_long_name": {"\u0078xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx": 1}})"));
+    return true;
+}
+
 auto test() -> bool {
     const auto tests = std::array{
         &lexer_test,
@@ -271,6 +612,7 @@ auto test() -> bool {
         &array_test,
         &nest_test,
         &string_test,
+        &escape_test,
         &comment_test,
         &trailing_comma_test,
     };
@@ -285,6 +627,31 @@ auto test() -> bool {
         ensure(parsed2 == test->object);
         std::println("stage2 ok");
     }
+
+    for(const auto str : invalid_strings) {
+        ensure(!parse(str, {.validate_utf8 = true}));
+    }
+    std::println("invalid strings ok");
+    ensure(test_reader());
+    std::println("reader ok");
+    ensure(test_equality());
+    std::println("equality ok");
+    ensure(test_patch(tests));
+    std::println("patch ok");
+    ensure(test_msgpack(tests));
+    std::println("msgpack ok");
+    ensure(test_snapshot(tests));
+    std::println("snapshot ok");
+    ensure(test_deparser(tests));
+    std::println("deparser ok");
+    ensure(test_builder());
+    std::println("builder ok");
+    ensure(test_shared_tree());
+    std::println("shared tree ok");
+    ensure(test_shared_document());
+    std::println("shared document ok");
+    ensure(test_schema());
+    std::println("schema ok");
     return true;
 }
 } // namespace
@@ -0,0 +1,224 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <format>
+
+#include "json.hpp"
+#include "utf8.hpp"
+
+namespace json {
+enum class FloatFormat {
+    Shortest, // shortest representation which round-trips
+    Fixed,
+    Scientific,
+};
+
+struct DeparseOpts {
+    int         indent       = 0; // 0 for compact output
+    bool        sort_keys    = false;
+    bool        ascii_only   = false; // escape non-ascii characters as \uXXXX
+    FloatFormat float_format = FloatFormat::Shortest;
+    int         precision    = 6; // ignored for FloatFormat::Shortest
+};
+
+namespace impl {
+template <DeparseOpts opts>
+struct Deparser {
+    static constexpr auto pretty = opts.indent > 0;
+
+    std::string& str;
+    int          depth = 0;
+
+    auto newline() -> void {
+        if constexpr(pretty) {
+            str += '\n';
+            str.append(size_t(depth * opts.indent), ' ');
+        }
+    }
+
+    auto deparse_number(const double value) -> void {
+        auto       buf = std::array<char, 64>();
+        const auto ret = opts.float_format == FloatFormat::Shortest
+                             ? std::to_chars(buf.data(), buf.data() + buf.size(), value)
+                             : std::to_chars(buf.data(), buf.data() + buf.size(), value,
+                                             opts.float_format == FloatFormat::Fixed ? std::chars_format::fixed : std::chars_format::scientific,
+                                             opts.precision);
+        if(ret.ec == std::errc()) {
+            str.append(buf.data(), ret.ptr);
+        } else if(opts.float_format == FloatFormat::Fixed) {
+            // too long for the buffer
+            str += std::format("{:.{}f}", value, opts.precision);
+        } else {
+            str += std::format("{:.{}e}", value, opts.precision);
+        }
+    }
+
+    auto escape_unicode(const uint32_t code) -> void {
+        if(code >= 0x10000) {
+            escape_unicode(0xd800 + ((code - 0x10000) >> 10));
+            escape_unicode(0xdc00 + ((code - 0x10000) & 0x3ff));
+            return;
+        }
+        constexpr auto digits = std::string_view("0123456789abcdef");
+        str += "\\u";
+        for(auto shift = 12; shift >= 0; shift -= 4) {
+            str += digits[(code >> shift) & 0x0f];
+        }
+    }
+
+    // escapes the utf-8 sequence at value[i], returns its length
+    // invalid sequences are replaced with U+FFFD one byte at a time
+    auto escape_utf8(const std::string_view value, const size_t i) -> size_t {
+        const auto seq = utf8_sequence(value, i);
+        if(!seq) {
+            escape_unicode(0xfffd);
+            return 1;
+        }
+        escape_unicode(seq->code);
+        return seq->len;
+    }
+
+    auto deparse_string(const std::string_view value) -> void {
+        str += '"';
+        // copy runs of characters which need no escape in bulk
+        auto run = size_t(0);
+        for(auto i = size_t(0); i < value.size();) {
+            const auto c = value[i];
+            if(uint8_t(c) >= 0x20 && c != '"' && c != '\\' && (!opts.ascii_only || uint8_t(c) < 0x80)) {
+                i += 1;
+                continue;
+            }
+            str.append(value.data() + run, i - run);
+            switch(c) {
+            case '"':
+                str += "\\\"";
+                break;
+            case '\\':
+                str += "\\\\";
+                break;
+            case '\b':
+                str += "\\b";
+                break;
+            case '\f':
+                str += "\\f";
+                break;
+            case '\n':
+                str += "\\n";
+                break;
+            case '\r':
+                str += "\\r";
+                break;
+            case '\t':
+                str += "\\t";
+                break;
+            default:
+                if(uint8_t(c) < 0x20) {
+                    escape_unicode(uint8_t(c));
+                } else {
+                    i += escape_utf8(value, i);
+                    run = i;
+                    continue;
+                }
+                break;
+            }
+            i += 1;
+            run = i;
+        }
+        str.append(value.data() + run, value.size() - run);
+        str += '"';
+    }
+
+    auto deparse_array(const Array& array) -> void {
+        if(array.value.empty()) {
+            str += "[]";
+            return;
+        }
+        str += '[';
+        depth += 1;
+        for(const auto& e : array.value) {
+            newline();
+            deparse_value(e);
+            str += ',';
+        }
+        str.pop_back(); // remove trailing comma
+        depth -= 1;
+        newline();
+        str += ']';
+    }
+
+    auto deparse_member(const Object::KeyValue& member) -> void {
+        newline();
+        deparse_string(member.key);
+        str += pretty ? ": " : ":";
+        deparse_value(member.value);
+        str += ',';
+    }
+
+    auto deparse_object(const Object& object) -> void {
+        if(object.children.empty()) {
+            str += "{}";
+            return;
+        }
+        str += '{';
+        depth += 1;
+        if constexpr(opts.sort_keys) {
+            auto members = std::vector<const Object::KeyValue*>();
+            members.reserve(object.children.size());
+            for(const auto& c : object.children) {
+                members.push_back(&c);
+            }
+            std::ranges::stable_sort(members, {}, &Object::KeyValue::key);
+            for(const auto member : members) {
+                deparse_member(*member);
+            }
+        } else {
+            for(const auto& member : object.children) {
+                deparse_member(member);
+            }
+        }
+        str.pop_back(); // remove trailing comma
+        depth -= 1;
+        newline();
+        str += '}';
+    }
+
+    auto deparse_value(const Value& value) -> void {
+        switch(value.get_index()) {
+        case Value::index_of<Number>:
+            deparse_number(value.as<Number>().value);
+            break;
+        case Value::index_of<String>:
+            deparse_string(value.as<String>().value);
+            break;
+        case Value::index_of<Boolean>:
+            str += value.as<Boolean>().value ? "true" : "false";
+            break;
+        case Value::index_of<Null>:
+            str += "null";
+            break;
+        case Value::index_of<Array>:
+            deparse_array(value.as<Array>());
+            break;
+        case Value::index_of<Object>:
+            deparse_object(value.as<Object>());
+            break;
+        }
+    }
+};
+} // namespace impl
+
+// deparse with options fixed at compile time, the plain deparse uses DeparseOpts{}
+template <DeparseOpts opts>
+auto deparse(const Object& object) -> std::string {
+    auto ret = std::string();
+    impl::Deparser<opts>{ret}.deparse_object(object);
+    return ret;
+}
+
+template <DeparseOpts opts>
+auto deparse(const Value& value) -> std::string {
+    auto ret = std::string();
+    impl::Deparser<opts>{ret}.deparse_value(value);
+    return ret;
+}
+} // namespace json
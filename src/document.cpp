@@ -0,0 +1,80 @@
+#include <thread>
+#include <utility>
+
+#include "document.hpp"
+
+namespace json {
+struct SharedDocument::Node : std::enable_shared_from_this<Node> {
+    Object object;
+};
+
+// hazard pointer, announces that a reader is about to take a reference to node
+struct SharedDocument::Hazard {
+    std::atomic<Node*> node   = nullptr;
+    std::atomic_bool   active = false;
+    Hazard*            next   = nullptr;
+};
+
+auto SharedDocument::acquire_hazard() const -> Hazard* {
+    // reuse a released record
+    for(auto hazard = hazards.load(); hazard != nullptr; hazard = hazard->next) {
+        auto expected = false;
+        if(!hazard->active.load(std::memory_order_relaxed) && hazard->active.compare_exchange_strong(expected, true)) {
+            return hazard;
+        }
+    }
+    // or push a new one
+    const auto hazard = new Hazard();
+    hazard->active.store(true);
+    auto head = hazards.load();
+    do {
+        hazard->next = head;
+    } while(!hazards.compare_exchange_weak(head, hazard));
+    return hazard;
+}
+
+auto SharedDocument::load() const -> std::shared_ptr<const Object> {
+    const auto hazard = acquire_hazard();
+    auto       node   = current.load();
+    while(true) {
+        hazard->node.store(node);
+        // the writer does not release node while it is announced, but it may have been replaced before the announcement
+        const auto latest = current.load();
+        if(latest == node) {
+            break;
+        }
+        node = latest;
+    }
+    auto ret = node != nullptr ? std::shared_ptr<const Object>(node->shared_from_this(), &node->object) : nullptr;
+    hazard->node.store(nullptr);
+    hazard->active.store(false, std::memory_order_release);
+    return ret;
+}
+
+auto SharedDocument::store(Object object) -> void {
+    auto node    = std::make_shared<Node>();
+    node->object = std::move(object);
+
+    const auto lock = std::lock_guard(writer_lock);
+    const auto old  = current.exchange(node.get());
+    // wait for readers which announced old but have not taken their references yet
+    // this is a matter of a few instructions on the reader side
+    for(auto hazard = old != nullptr ? hazards.load() : nullptr; hazard != nullptr; hazard = hazard->next) {
+        while(hazard->node.load() == old) {
+            std::this_thread::yield();
+        }
+    }
+    owner = std::move(node);
+}
+
+SharedDocument::SharedDocument(Object object) {
+    store(std::move(object));
+}
+
+SharedDocument::~SharedDocument() {
+    auto hazard = hazards.load();
+    while(hazard != nullptr) {
+        delete std::exchange(hazard, hazard->next);
+    }
+}
+} // namespace json
@@ -0,0 +1,32 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "json.hpp"
+
+namespace json {
+// holds a document which can be replaced while other threads are reading it
+// readers never block and a replaced document is freed when its last reader releases it
+class SharedDocument {
+  private:
+    struct Node;
+    struct Hazard;
+
+    std::atomic<Node*>           current = nullptr;
+    mutable std::atomic<Hazard*> hazards = nullptr; // never shrinks until destruction
+    std::shared_ptr<Node>        owner;             // keeps current alive
+    std::mutex                   writer_lock;
+
+    auto acquire_hazard() const -> Hazard*;
+
+  public:
+    // returns null if nothing is stored yet
+    auto load() const -> std::shared_ptr<const Object>;
+    auto store(Object object) -> void;
+
+    SharedDocument() = default;
+    SharedDocument(Object object);
+    ~SharedDocument();
+};
+} // namespace json
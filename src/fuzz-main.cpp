@@ -0,0 +1,44 @@
+// driver for the fuzz targets where libFuzzer is not available
+// usage: fuzz-parse FILE_OR_DIR...
+// every input is run once, there is no mutation, use a clang build for actual fuzzing
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <string>
+#include <vector>
+
+extern "C" auto LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) -> int;
+
+namespace {
+auto run(const std::filesystem::path& path) -> void {
+    std::println(stderr, "running {}", path.string());
+    auto       file  = std::ifstream(path, std::ios::binary);
+    const auto input = std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+}
+} // namespace
+
+auto main(const int argc, const char* const argv[]) -> int {
+    auto files = std::vector<std::filesystem::path>();
+    for(auto i = 1; i < argc; i += 1) {
+        const auto path = std::filesystem::path(argv[i]);
+        if(!std::filesystem::is_directory(path)) {
+            files.push_back(path);
+            continue;
+        }
+        for(const auto& entry : std::filesystem::directory_iterator(path)) {
+            if(entry.is_regular_file()) {
+                files.push_back(entry.path());
+            }
+        }
+    }
+    std::ranges::sort(files);
+    for(const auto& file : files) {
+        run(file);
+    }
+    std::println("ran {} inputs", files.size());
+    return 0;
+}
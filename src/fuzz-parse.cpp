@@ -0,0 +1,165 @@
+// libFuzzer target, cross-checks every parse mode and output format against parse_value
+#include <cmath>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "deparser.hpp"
+#include "json.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "reader.hpp"
+#include "schema.hpp"
+#include "snapshot.hpp"
+
+namespace {
+using namespace json;
+
+auto check(const bool ok) -> void {
+    if(!ok) {
+        std::abort();
+    }
+}
+
+// non-finite numbers have no text representation
+auto is_finite(const Value& value) -> bool {
+    switch(value.get_index()) {
+    case Value::index_of<Number>:
+        return std::isfinite(value.as<Number>().value);
+    case Value::index_of<Array>:
+        for(const auto& e : value.as<Array>().value) {
+            if(!is_finite(e)) {
+                return false;
+            }
+        }
+        return true;
+    case Value::index_of<Object>:
+        for(const auto& [key, e] : value.as<Object>().children) {
+            if(!is_finite(e)) {
+                return false;
+            }
+        }
+        return true;
+    default:
+        return true;
+    }
+}
+
+template <DeparseOpts opts>
+auto check_round_trip(const Value& value) -> void {
+    const auto str    = deparse<opts>(value);
+    const auto parsed = parse_value(str, {.allow_comments = false, .allow_trailing_commas = false, .validate_utf8 = false});
+    check(parsed && *parsed == value);
+}
+
+struct Wrapper {
+    Value value;
+};
+
+using WrapperSchema = schema::Schema<Wrapper, schema::Field<"v", &Wrapper::value>>;
+
+// typed schema, the long names make escaped keys outgrow the key buffer
+struct Item {
+    std::string                         name;
+    std::optional<std::vector<int64_t>> ids;
+    std::optional<std::string>          description_of_the_item;
+};
+
+struct Root {
+    Item                  item_with_a_long_name;
+    std::vector<Item>     items;
+    std::optional<double> score;
+};
+
+using ItemSchema = schema::Schema<Item,
+                                  schema::Field<"name", &Item::name>,
+                                  schema::Field<"ids", &Item::ids>,
+                                  schema::Field<"description_of_the_item", &Item::description_of_the_item>>;
+using RootSchema = schema::Schema<Root,
+                                  schema::Field<"item_with_a_long_name", &Root::item_with_a_long_name, ItemSchema>,
+                                  schema::Field<"items", &Root::items, ItemSchema>,
+                                  schema::Field<"score", &Root::score>>;
+
+auto check_modes(const std::string_view str, const ParseOpts opts) -> void {
+    const auto value = parse_value(str, opts);
+
+    // token level parser
+    if(auto tokens = tokenize(str, opts.allow_comments, opts.validate_utf8)) {
+        const auto parsed = parse_value(std::span(*tokens), opts.allow_trailing_commas);
+        check(parsed.has_value() == value.has_value());
+        check(!parsed || *parsed == *value);
+    } else {
+        check(!value);
+    }
+
+    // parse accepts exactly the objects
+    const auto object = parse(str, opts);
+    check(object.has_value() == (value && value->get<Object>() != nullptr));
+    check(!object || *object == value->as<Object>());
+
+    // the typed schema accepts a subset of the objects
+    if(const auto root = schema::parse<RootSchema>(str, opts)) {
+        check(object.has_value());
+        const auto item = object->find<Object>("item_with_a_long_name");
+        check(item && item->find<String>("name") && item->find<String>("name")->value == root->item_with_a_long_name.name);
+        check(object->find<Array>("items") && object->find<Array>("items")->value.size() == root->items.size());
+    }
+
+    if(!value) {
+        return;
+    }
+
+    // a single document through the reader
+    auto reader = Reader{.str = str, .opts = opts};
+    check(!reader.is_eof());
+    const auto read = reader.read();
+    check(read && *read == *value && reader.is_eof());
+
+    // schema parser with a generic member, the newline ends a trailing line comment
+    const auto wrapped = schema::parse<WrapperSchema>("{\"v\":" + std::string(str) + "\n}", opts);
+    check(wrapped && wrapped->value == *value);
+
+    // validation only rejects
+    if(opts.validate_utf8) {
+        auto lax          = opts;
+        lax.validate_utf8 = false;
+        const auto parsed = parse_value(str, lax);
+        check(parsed && *parsed == *value);
+    }
+}
+
+// ascii_only output replaces invalid utf-8 sequences, so it round-trips only for valid strings
+auto check_formats(const Value& value, const bool valid_utf8) -> void {
+    if(is_finite(value)) {
+        check_round_trip<DeparseOpts{}>(value);
+        check_round_trip<DeparseOpts{.indent = 2, .sort_keys = true}>(value);
+        if(valid_utf8) {
+            check_round_trip<DeparseOpts{.indent = 1, .ascii_only = true}>(value);
+        }
+    }
+
+    const auto msgpack = decode_msgpack(encode_msgpack(value));
+    check(msgpack && *msgpack == value);
+
+    if(const auto object = value.get<Object>()) {
+        const auto image = snapshot::write(*object);
+        const auto root  = snapshot::open_image(image);
+        check(root && root->to_object() == *object);
+        for(const auto& [key, e] : object->children) {
+            const auto found = root->find(key);
+            check(found && found->to_value() == *object->find(key));
+        }
+    }
+}
+} // namespace
+
+extern "C" auto LLVMFuzzerTestOneInput(const uint8_t* const data, const size_t size) -> int {
+    const auto str = std::string_view(reinterpret_cast<const char*>(data), size);
+    check_modes(str, {});
+    check_modes(str, {.allow_comments = false, .allow_trailing_commas = false, .validate_utf8 = true});
+    if(const auto value = parse_value(str)) {
+        check_formats(*value, parse_value(str, {.validate_utf8 = true}).has_value());
+    }
+    return 0;
+}
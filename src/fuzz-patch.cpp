@@ -0,0 +1,65 @@
+// libFuzzer target, checks that applying diff(a, b) to a yields b
+// input is two documents followed by an optional arbitrary patch, read as concatenated values
+#include <cstdlib>
+
+#include "json.hpp"
+#include "reader.hpp"
+
+namespace {
+using namespace json;
+
+auto check(const bool ok) -> void {
+    if(!ok) {
+        std::abort();
+    }
+}
+
+// a patch can only address the first of duplicated keys
+auto has_duplicated_keys(const Value& value) -> bool {
+    if(const auto array = value.get<Array>()) {
+        for(const auto& e : array->value) {
+            if(has_duplicated_keys(e)) {
+                return true;
+            }
+        }
+    } else if(const auto object = value.get<Object>()) {
+        const auto& children = object->children;
+        for(auto i = 0u; i < children.size(); i += 1) {
+            if(object->find(children[i].key) != &children[i].value || has_duplicated_keys(children[i].value)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+} // namespace
+
+extern "C" auto LLVMFuzzerTestOneInput(const uint8_t* const data, const size_t size) -> int {
+    auto reader = Reader{.str = std::string_view(reinterpret_cast<const char*>(data), size)};
+    auto a      = reader.read();
+    auto b      = reader.read();
+    if(!a || !b || !a->get<Object>() || !b->get<Object>() || has_duplicated_keys(*a) || has_duplicated_keys(*b)) {
+        return 0;
+    }
+    const auto& from = a->as<Object>();
+    const auto& to   = b->as<Object>();
+
+    const auto patch  = diff(from, to);
+    auto       object = from;
+    check(apply_patch(object, patch));
+    check(object == to);
+
+    // the patch survives serialization
+    const auto parsed = parse_value(deparse(Value::create<Array>(patch)));
+    check(parsed && parsed->get<Array>());
+    object = from;
+    check(apply_patch(object, parsed->as<Array>()));
+    check(object == to);
+
+    // arbitrary patches must fail cleanly
+    if(const auto extra = reader.read(); extra && extra->get<Array>()) {
+        object = from;
+        apply_patch(object, extra->as<Array>());
+    }
+    return 0;
+}
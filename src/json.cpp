@@ -1,17 +1,28 @@
+#include <algorithm>
+#include <utility>
+
 #include "json.hpp"
+#include "key-index.hpp"
 
 namespace json {
 auto Object::find(const std::string_view key) -> Value* {
-    for(auto& c : children) {
-        if(c.key == key) {
-            return &c.value;
+    // search through the const view, so that shared children are detached only when found
+    const auto& c = std::as_const(children);
+    for(auto i = size_t(0); i < c.size(); i += 1) {
+        if(c[i].key == key) {
+            return &children[i].value;
         }
     }
     return nullptr;
 }
 
 auto Object::find(const std::string_view key) const -> const Value* {
-    return const_cast<Object*>(this)->find(key);
+    for(const auto& c : children) {
+        if(c.key == key) {
+            return &c.value;
+        }
+    }
+    return nullptr;
 }
 
 auto Object::operator[](const std::string_view key) -> Value& {
@@ -21,4 +32,105 @@ auto Object::operator[](const std::string_view key) -> Value& {
     }
     return *value;
 }
+
+auto Object::reserve(const size_t size) -> void {
+    children.reserve(size);
+}
+
+auto Object::erase(const std::string_view key) -> bool {
+    for(auto i = children.begin(); i != children.end(); i = std::next(i)) {
+        if(i->key == key) {
+            children.erase(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+auto Array::reserve(const size_t size) -> void {
+    value.reserve(size);
+}
+
+auto Array::erase(const size_t index) -> bool {
+    if(index >= value.size()) {
+        return false;
+    }
+    value.erase(value.begin() + index);
+    return true;
+}
+
+auto operator==(const Value& a, const Value& b) -> bool {
+    if(a.get_index() != b.get_index()) {
+        return false;
+    }
+    switch(a.get_index()) {
+    case Value::index_of<Number>:
+        return a.as<Number>().value == b.as<Number>().value;
+    case Value::index_of<String>:
+        return a.as<String>().value == b.as<String>().value;
+    case Value::index_of<Boolean>:
+        return a.as<Boolean>().value == b.as<Boolean>().value;
+    case Value::index_of<Null>:
+        return true;
+    case Value::index_of<Array>:
+        return a.as<Array>() == b.as<Array>();
+    case Value::index_of<Object>:
+        return a.as<Object>() == b.as<Object>();
+    }
+    return false;
+}
+
+auto operator==(const Array& a, const Array& b) -> bool {
+    return a.value == b.value;
+}
+
+auto operator==(const Object& a, const Object& b) -> bool {
+    // key order does not matter, duplicated keys are matched in order of appearance
+    const auto& x = a.children;
+    const auto& y = b.children;
+    if(x.size() != y.size()) {
+        return false;
+    }
+    auto same_order = true;
+    for(auto i = size_t(0); i < x.size() && same_order; i += 1) {
+        same_order = x[i].key == y[i].key;
+    }
+    if(same_order) {
+        for(auto i = size_t(0); i < x.size(); i += 1) {
+            if(!(x[i].value == y[i].value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    // both sorted by key, so the n-th member under a key meets the n-th one of the other
+    const auto ia = impl::make_key_index(a);
+    const auto ib = impl::make_key_index(b);
+    for(auto i = size_t(0); i < x.size(); i += 1) {
+        const auto& p = x[ia.order[i]];
+        const auto& q = y[ib.order[i]];
+        if(p.key != q.key || !(p.value == q.value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace impl {
+auto make_key_index(const Object& object) -> KeyIndex {
+    const auto& children = object.children;
+    auto        order    = std::vector<size_t>(children.size());
+    for(auto i = size_t(0); i < order.size(); i += 1) {
+        order[i] = i;
+    }
+    std::ranges::stable_sort(order, {}, [&children](const size_t i) -> std::string_view { return children[i].key; });
+    return KeyIndex{&object, std::move(order)};
+}
+
+auto KeyIndex::find(const std::string_view key) const -> const Value* {
+    const auto& children = object->children;
+    const auto  i        = std::ranges::lower_bound(order, key, {}, [&children](const size_t i) -> std::string_view { return children[i].key; });
+    return i != order.end() && children[*i].key == key ? &children[*i].value : nullptr;
+}
+} // namespace impl
 } // namespace json
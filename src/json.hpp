@@ -1,10 +1,26 @@
 #pragma once
+#include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
 #include "util/variant.hpp"
 
+#if defined(TINYJSON_SHARED_TREE)
+#include "cow-vector.hpp"
+#endif
+
 namespace json {
+// with TINYJSON_SHARED_TREE, copies of arrays and objects share their elements
+// copying a tree is O(1) and a modification copies only the nodes on the path to it
+#if defined(TINYJSON_SHARED_TREE)
+template <class T>
+using Vector = CowVector<T>;
+#else
+template <class T>
+using Vector = std::vector<T>;
+#endif
+
 struct Number;
 struct String;
 struct Boolean;
@@ -29,13 +45,25 @@ struct Boolean {
 struct Null {
 };
 
+// const member functions of Array and Object do not modify any state, even with TINYJSON_SHARED_TREE
+// so a tree can be read from any number of threads as long as nobody modifies it
 struct Array {
-    std::vector<Value> value;
+    Vector<Value> value;
+
+    template <class T, class... Args>
+    auto emplace_back(Args&&... args) -> T&;
+    // appends [first, last), pass move iterators to move the elements
+    template <class Iterator>
+    auto insert(Iterator first, Iterator last) -> void;
+
+    auto reserve(size_t size) -> void;
+    // returns false if index is out of range
+    auto erase(size_t index) -> bool;
 };
 
 struct Object {
     struct KeyValue;
-    std::vector<KeyValue> children;
+    Vector<KeyValue> children;
 
     template <class T>
     auto find(std::string_view key) -> T* {
@@ -48,12 +76,30 @@ struct Object {
 
     template <class T>
     auto find(std::string_view key) const -> const T* {
-        return const_cast<Object*>(this)->find<T>(key);
+        const auto p = find(key);
+        if(!p) {
+            return nullptr;
+        }
+        return p->get<T>();
     }
 
+    // appends without checking for duplicated keys
+    template <class T, class... Args>
+    auto emplace_back(std::string key, Args&&... args) -> T&;
+    // constructs a T only if key does not exist yet
+    // returns the value under key and whether it was inserted
+    template <class T, class... Args>
+    auto try_emplace(std::string_view key, Args&&... args) -> std::pair<Value*, bool>;
+    // appends [first, last) without checking for duplicated keys, pass move iterators to move the elements
+    template <class Iterator>
+    auto insert(Iterator first, Iterator last) -> void;
+
     auto find(std::string_view key) -> Value*;
     auto find(std::string_view key) const -> const Value*;
     auto operator[](std::string_view key) -> Value&;
+    auto reserve(size_t size) -> void;
+    // returns false if key does not exist
+    auto erase(std::string_view key) -> bool;
 };
 
 struct Object::KeyValue {
@@ -61,41 +107,92 @@ struct Object::KeyValue {
     Value       value;
 };
 
+template <class T, class... Args>
+auto Array::emplace_back(Args&&... args) -> T& {
+    return value.emplace_back(Value::create<T>(std::forward<Args>(args)...)).template as<T>();
+}
+
+template <class Iterator>
+auto Array::insert(const Iterator first, const Iterator last) -> void {
+    value.insert(value.end(), first, last);
+}
+
+template <class T, class... Args>
+auto Object::emplace_back(std::string key, Args&&... args) -> T& {
+    return children.emplace_back(std::move(key), Value::create<T>(std::forward<Args>(args)...)).value.template as<T>();
+}
+
+template <class T, class... Args>
+auto Object::try_emplace(const std::string_view key, Args&&... args) -> std::pair<Value*, bool> {
+    if(const auto value = find(key)) {
+        return {value, false};
+    }
+    return {&children.emplace_back(std::string(key), Value::create<T>(std::forward<Args>(args)...)).value, true};
+}
+
+template <class Iterator>
+auto Object::insert(const Iterator first, const Iterator last) -> void {
+    children.insert(children.end(), first, last);
+}
+
+// json.cpp
+auto operator==(const Value& a, const Value& b) -> bool;
+auto operator==(const Array& a, const Array& b) -> bool;
+auto operator==(const Object& a, const Object& b) -> bool;
+
 // helper
+// push_back hands out no reference, so the built tree stays shareable with TINYJSON_SHARED_TREE
 template <class Arg>
 auto array_append(Array& array, Arg&& arg) -> void {
-    array.value.push_back(Value::create<std::remove_cvref_t<Arg>>(std::move(arg)));
+    array.value.push_back(Value::create<std::remove_cvref_t<Arg>>(std::forward<Arg>(arg)));
 }
 
 template <class Arg, class... Args>
 auto array_append(Array& array, Arg&& arg, Args&&... args) -> void {
-    array.value.push_back(Value::create<std::remove_cvref_t<Arg>>(std::move(arg)));
+    array_append(array, std::forward<Arg>(arg));
     array_append(array, std::forward<Args>(args)...);
 }
 
 template <class... Args>
 auto make_array(Args&&... args) -> Array {
     auto array = Array();
-    array.value.reserve(sizeof...(Args));
+    array.reserve(sizeof...(Args));
     array_append(array, std::forward<Args>(args)...);
     return array;
 }
 
+// sets or replaces the value under key
 template <class Arg>
 auto object_append(Object& object, const std::string_view key, Arg&& arg) -> void {
-    object[key] = Value::create<std::remove_cvref_t<Arg>>(std::move(arg));
+    object[key] = Value::create<std::remove_cvref_t<Arg>>(std::forward<Arg>(arg));
 }
 
 template <class Arg, class... Args>
 auto object_append(Object& object, const std::string_view key, Arg&& arg, Args&&... args) -> void {
-    object_append(object, key, std::move(arg));
+    object_append(object, key, std::forward<Arg>(arg));
     object_append(object, std::forward<Args>(args)...);
 }
 
+namespace impl {
+// appends without looking key up
+template <class Arg>
+auto object_push(Object& object, const std::string_view key, Arg&& arg) -> void {
+    object.children.push_back({std::string(key), Value::create<std::remove_cvref_t<Arg>>(std::forward<Arg>(arg))});
+}
+
+template <class Arg, class... Args>
+auto object_push(Object& object, const std::string_view key, Arg&& arg, Args&&... args) -> void {
+    object_push(object, key, std::forward<Arg>(arg));
+    object_push(object, std::forward<Args>(args)...);
+}
+} // namespace impl
+
+// keys are not checked for duplicates
 template <class Arg, class... Args>
 auto make_object(const std::string_view key, Arg&& arg, Args&&... args) -> Object {
     auto object = Object();
-    object_append(object, key, std::move(arg), std::forward<Args>(args)...);
+    object.reserve(1 + sizeof...(Args) / 2);
+    impl::object_push(object, key, std::forward<Arg>(arg), std::forward<Args>(args)...);
     return object;
 }
 
@@ -103,9 +200,25 @@ auto make_object(const std::string_view key, Arg&& arg, Args&&... args) -> Objec
 struct ParseOpts {
     bool allow_comments        = true;
     bool allow_trailing_commas = true;
+    bool validate_utf8         = false;
 };
 auto parse(std::string_view str, ParseOpts opts = {}) -> std::optional<Object>;
+auto parse_value(std::string_view str, ParseOpts opts = {}) -> std::optional<Value>;
+
+// patch.cpp
+// creates a RFC 6902 JSON Patch which transforms from into to
+auto diff(const Object& from, const Object& to) -> Array;
+// applies a RFC 6902 JSON Patch in place
+// operations before a failing one are not rolled back
+auto apply_patch(Object& object, const Array& patch) -> bool;
+
+// msgpack.cpp
+auto encode_msgpack(const Value& value) -> std::vector<std::byte>;
+auto encode_msgpack(const Object& object) -> std::vector<std::byte>;
+auto decode_msgpack(std::span<const std::byte> data) -> std::optional<Value>;
 
 // deparser.cpp
+// compact output, deparser.hpp has the configurable versions
 auto deparse(const Object& object) -> std::string;
+auto deparse(const Value& value) -> std::string;
 } // namespace json
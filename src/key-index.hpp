@@ -0,0 +1,20 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+#include "json.hpp"
+
+namespace json::impl {
+// members of an object sorted by key, for lookups in O(log n)
+// duplicated keys stay in order of appearance
+struct KeyIndex {
+    const Object*       object;
+    std::vector<size_t> order; // indices into object->children
+
+    // returns the first value under key, like Object::find
+    auto find(std::string_view key) const -> const Value*;
+};
+
+// json.cpp
+auto make_key_index(const Object& object) -> KeyIndex;
+} // namespace json::impl
@@ -1,3 +1,6 @@
+#include <bit>
+#include <cstdint>
+#include <cstring>
 #include <string_view>
 #include <vector>
 
@@ -5,12 +8,185 @@
 #include "macros/unwrap.hpp"
 #include "string-reader/string-reader.hpp"
 #include "util/charconv.hpp"
+#include "utf8.hpp"
 
 namespace json {
+namespace {
+// word-at-a-time helpers for the string fast path
+constexpr auto word_ones  = ~uint64_t(0) / 0xff; // 0x0101...01
+constexpr auto word_highs = word_ones * 0x80;    // 0x8080...80
+
+auto load_word(const char* ptr) -> uint64_t {
+    auto word = uint64_t();
+    std::memcpy(&word, ptr, sizeof(word));
+    return word;
+}
+
+// nonzero if any byte of word equals c
+auto match_byte(const uint64_t word, const uint8_t c) -> uint64_t {
+    const auto x = word ^ (word_ones * c);
+    return (x - word_ones) & ~x & word_highs;
+}
+
+// length of the leading run that contains neither '"' nor '\\'
+auto find_plain_run(const std::string_view str) -> size_t {
+    auto i = size_t(0);
+    for(; i + 8 <= str.size(); i += 8) {
+        const auto word = load_word(str.data() + i);
+        const auto mask = match_byte(word, '"') | match_byte(word, '\\');
+        if(mask == 0) {
+            continue;
+        }
+        if constexpr(std::endian::native == std::endian::little) {
+            // the lowest flagged byte is always a true match
+            return i + std::countr_zero(mask) / 8;
+        }
+        break;
+    }
+    for(; i < str.size(); i += 1) {
+        if(str[i] == '"' || str[i] == '\\') {
+            break;
+        }
+    }
+    return i;
+}
+
+auto is_valid_utf8(const std::string_view str) -> bool {
+    auto i = size_t(0);
+    while(i < str.size()) {
+        // skip ascii in bulk
+        if(i + 8 <= str.size() && (load_word(str.data() + i) & word_highs) == 0) {
+            i += 8;
+            continue;
+        }
+        if(uint8_t(str[i]) < 0x80) {
+            i += 1;
+            continue;
+        }
+        const auto seq = utf8_sequence(str, i);
+        if(!seq) {
+            return false;
+        }
+        i += seq->len;
+    }
+    return true;
+}
+
+auto append_utf8(std::string& str, const uint32_t code) -> void {
+    if(code < 0x80) {
+        str.push_back(char(code));
+    } else if(code < 0x800) {
+        str.push_back(char(0xc0 | (code >> 6)));
+        str.push_back(char(0x80 | (code & 0x3f)));
+    } else if(code < 0x10000) {
+        str.push_back(char(0xe0 | (code >> 12)));
+        str.push_back(char(0x80 | ((code >> 6) & 0x3f)));
+        str.push_back(char(0x80 | (code & 0x3f)));
+    } else {
+        str.push_back(char(0xf0 | (code >> 18)));
+        str.push_back(char(0x80 | ((code >> 12) & 0x3f)));
+        str.push_back(char(0x80 | ((code >> 6) & 0x3f)));
+        str.push_back(char(0x80 | (code & 0x3f)));
+    }
+}
+
+auto read_hex4(StringReader& reader) -> std::optional<uint32_t> {
+    unwrap(hex, reader.read(4));
+    auto code = uint32_t(0);
+    for(const auto c : hex) {
+        code <<= 4;
+        if(c >= '0' && c <= '9') {
+            code |= c - '0';
+        } else if(c >= 'a' && c <= 'f') {
+            code |= c - 'a' + 10;
+        } else if(c >= 'A' && c <= 'F') {
+            code |= c - 'A' + 10;
+        } else {
+            bail("invalid hex digit '{}'", c);
+        }
+    }
+    return code;
+}
+
+// reader points to the character after '\\'
+auto decode_escape(StringReader& reader, std::string& str) -> bool {
+    unwrap(c, reader.read());
+    switch(c) {
+    case '"':
+    case '\\':
+    case '/':
+        str.push_back(c);
+        return true;
+    case 'b':
+        str.push_back('\b');
+        return true;
+    case 'f':
+        str.push_back('\f');
+        return true;
+    case 'n':
+        str.push_back('\n');
+        return true;
+    case 'r':
+        str.push_back('\r');
+        return true;
+    case 't':
+        str.push_back('\t');
+        return true;
+    case 'u':
+        break;
+    default:
+        bail("invalid escape sequence '\\{}'", c);
+    }
+
+    unwrap(code, read_hex4(reader));
+    if(code >= 0xdc00 && code <= 0xdfff) {
+        bail("unpaired low surrogate {:x}", code);
+    }
+    if(code < 0xd800 || code > 0xdbff) {
+        append_utf8(str, code);
+        return true;
+    }
+    // high surrogate, must be followed by a low one
+    unwrap(next, reader.read(2));
+    if(next != "\\u") {
+        bail("unpaired high surrogate {:x}", code);
+    }
+    unwrap(low, read_hex4(reader));
+    if(low < 0xdc00 || low > 0xdfff) {
+        bail("invalid low surrogate {:x}", low);
+    }
+    append_utf8(str, 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00));
+    return true;
+}
+} // namespace
+
+auto decode_string(StringReader& reader, const bool validate_utf8, std::string& str) -> bool {
+    ensure(reader.read() == '"');
+    while(true) {
+        // copy escape-free runs in bulk
+        const auto run = reader.str.substr(std::min(reader.cursor, reader.str.size()));
+        const auto len = find_plain_run(run);
+        if(len == run.size()) {
+            bail("unterminated string");
+        }
+        if(validate_utf8 && !is_valid_utf8(run.substr(0, len))) {
+            bail("invalid utf-8 in string");
+        }
+        str.append(run.data(), len);
+        reader.cursor += len;
+
+        if(reader.read() == '"') {
+            return true;
+        }
+        ensure(decode_escape(reader, str));
+    }
+}
+
 namespace {
 struct Lexer {
     StringReader reader;
     bool         allow_comments = false;
+    bool         validate_utf8  = false;
 
     auto skip_comment() -> bool {
         ensure(reader.read()); // skip '/'
@@ -27,20 +203,8 @@ struct Lexer {
     }
 
     auto parse_string_token() -> std::optional<Token> {
-        ensure(reader.read()); // skip '"'
         auto str = std::string();
-        while(true) {
-            unwrap(c, reader.read());
-            if(c == '\\') {
-                unwrap(d, reader.read());
-                str.push_back(d);
-                continue;
-            }
-            if(c == '"') {
-                break;
-            }
-            str.push_back(c);
-        }
+        ensure(decode_string(reader, validate_utf8, str));
         return Token::create<token::String>(std::move(str));
     }
 
@@ -67,7 +231,12 @@ struct Lexer {
     auto parse_number_token() -> std::optional<Token> {
         auto len = 0;
         while(true) {
-            unwrap(next, reader.peek());
+            // a top-level number may end the input
+            const auto peeked = reader.peek();
+            if(!peeked) {
+                break;
+            }
+            const auto next = *peeked;
             switch(next) {
             case '+':
             case '-':
@@ -144,6 +313,42 @@ struct Lexer {
         bail("unexpected character: '{}'", next);
     }
 
+    auto skip_blank() -> bool {
+        while(!reader.is_eof()) {
+            unwrap(next, reader.peek());
+            if(allow_comments && next == '/') {
+                ensure(skip_comment());
+                continue;
+            }
+            if(next != ' ' && next != '\n' && next != '\t' && next != '\r') {
+                break;
+            }
+            ensure(parse_next_token());
+        }
+        return true;
+    }
+
+    // tokenizes exactly one value, leaving the cursor just after it
+    auto tokenize_value(std::vector<Token>& tokens) -> bool {
+        auto depth = 0;
+        do {
+            ensure(skip_blank());
+            unwrap_mut(token, parse_next_token());
+            switch(token.get_index()) {
+            case Token::index_of<token::LeftBrace>:
+            case Token::index_of<token::LeftBracket>:
+                depth += 1;
+                break;
+            case Token::index_of<token::RightBrace>:
+            case Token::index_of<token::RightBracket>:
+                depth -= 1;
+                break;
+            }
+            tokens.push_back(std::move(token));
+        } while(depth > 0);
+        return true;
+    }
+
     auto tokenize() -> std::optional<std::vector<Token>> {
         auto tokens = std::vector<Token>();
         while(!reader.is_eof()) {
@@ -179,10 +384,11 @@ struct Lexer {
 };
 } // namespace
 
-auto tokenize(const std::string_view str, const bool allow_comments) -> std::optional<std::vector<Token>> {
+auto tokenize(const std::string_view str, const bool allow_comments, const bool validate_utf8) -> std::optional<std::vector<Token>> {
     auto lexer = Lexer{
         .reader         = StringReader{str},
         .allow_comments = allow_comments,
+        .validate_utf8  = validate_utf8,
     };
     auto ret_o = lexer.tokenize();
     if(!ret_o) {
@@ -192,4 +398,34 @@ auto tokenize(const std::string_view str, const bool allow_comments) -> std::opt
         return std::move(ret_o.value());
     }
 }
+
+auto tokenize_value(const std::string_view str, size_t& cursor, const bool allow_comments, const bool validate_utf8, std::vector<Token>& tokens) -> bool {
+    auto lexer = Lexer{
+        .reader         = StringReader{str},
+        .allow_comments = allow_comments,
+        .validate_utf8  = validate_utf8,
+    };
+    lexer.reader.cursor = cursor;
+    const auto ret      = lexer.tokenize_value(tokens);
+    cursor              = lexer.reader.cursor;
+    if(!ret) {
+        const auto [l, c] = lexer.get_current_pos();
+        bail("lexer error at line {}, character {}", l, c);
+    }
+    return true;
+}
+
+auto skip_blank(const std::string_view str, size_t& cursor, const bool allow_comments) -> bool {
+    auto lexer = Lexer{
+        .reader         = StringReader{str},
+        .allow_comments = allow_comments,
+    };
+    lexer.reader.cursor = cursor;
+    if(!lexer.skip_blank()) {
+        const auto [l, c] = lexer.get_current_pos();
+        bail("lexer error at line {}, character {}", l, c);
+    }
+    cursor = lexer.reader.cursor;
+    return true;
+}
 } // namespace json
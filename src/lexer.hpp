@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 
+#include "string-reader/string-reader.hpp"
 #include "util/variant.hpp"
 
 namespace json {
@@ -39,5 +40,14 @@ using Token = Variant<String, Number, Boolean, Null, WhiteSpace, LeftBrace, Righ
 
 using Token = token::Token;
 
-auto tokenize(std::string_view str, bool allow_comments) -> std::optional<std::vector<Token>>;
+// reads a string literal at the cursor and appends its decoded contents to str
+auto decode_string(StringReader& reader, bool validate_utf8, std::string& str) -> bool;
+
+auto tokenize(std::string_view str, bool allow_comments, bool validate_utf8) -> std::optional<std::vector<Token>>;
+
+// appends the tokens of the value at the cursor and advances the cursor past it
+auto tokenize_value(std::string_view str, size_t& cursor, bool allow_comments, bool validate_utf8, std::vector<Token>& tokens) -> bool;
+
+// advances the cursor past white spaces and comments
+auto skip_blank(std::string_view str, size_t& cursor, bool allow_comments) -> bool;
 } // namespace json
@@ -0,0 +1,310 @@
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "json.hpp"
+#include "macros/unwrap.hpp"
+
+namespace json {
+namespace {
+struct Encoder {
+    std::vector<std::byte> data;
+
+    auto put(const uint8_t byte) -> void {
+        data.push_back(std::byte(byte));
+    }
+
+    // big endian
+    template <class T>
+    auto put_be(const T value) -> void {
+        for(auto i = int(sizeof(T)) - 1; i >= 0; i -= 1) {
+            put(uint8_t(value >> (i * 8)));
+        }
+    }
+
+    auto encode_number(const double value) -> void {
+        if(value >= 0 && value < 0x1p64 && value == double(uint64_t(value)) && !std::signbit(value)) {
+            const auto u = uint64_t(value);
+            if(u < 0x80) {
+                put(uint8_t(u));
+            } else if(u <= 0xff) {
+                put(0xcc);
+                put_be(uint8_t(u));
+            } else if(u <= 0xffff) {
+                put(0xcd);
+                put_be(uint16_t(u));
+            } else if(u <= 0xffffffff) {
+                put(0xce);
+                put_be(uint32_t(u));
+            } else {
+                put(0xcf);
+                put_be(u);
+            }
+        } else if(value < 0 && value >= -0x1p63 && value == double(int64_t(value))) {
+            const auto i = int64_t(value);
+            if(i >= -32) {
+                put(uint8_t(i));
+            } else if(i >= INT8_MIN) {
+                put(0xd0);
+                put_be(uint8_t(i));
+            } else if(i >= INT16_MIN) {
+                put(0xd1);
+                put_be(uint16_t(i));
+            } else if(i >= INT32_MIN) {
+                put(0xd2);
+                put_be(uint32_t(i));
+            } else {
+                put(0xd3);
+                put_be(uint64_t(i));
+            }
+        } else if(double(float(value)) == value) {
+            put(0xca);
+            put_be(std::bit_cast<uint32_t>(float(value)));
+        } else {
+            put(0xcb);
+            put_be(std::bit_cast<uint64_t>(value));
+        }
+    }
+
+    auto encode_string(const std::string_view str) -> void {
+        if(str.size() < 32) {
+            put(0xa0 | str.size());
+        } else if(str.size() <= 0xff) {
+            put(0xd9);
+            put_be(uint8_t(str.size()));
+        } else if(str.size() <= 0xffff) {
+            put(0xda);
+            put_be(uint16_t(str.size()));
+        } else {
+            put(0xdb);
+            put_be(uint32_t(str.size()));
+        }
+        const auto bytes = std::as_bytes(std::span(str));
+        data.insert(data.end(), bytes.begin(), bytes.end());
+    }
+
+    // prefix is the fix form type, wide is the 16-bit form type
+    auto encode_container_header(const size_t len, const uint8_t prefix, const uint8_t wide) -> void {
+        if(len < 16) {
+            put(prefix | len);
+        } else if(len <= 0xffff) {
+            put(wide);
+            put_be(uint16_t(len));
+        } else {
+            put(wide + 1);
+            put_be(uint32_t(len));
+        }
+    }
+
+    auto encode_object(const Object& object) -> void {
+        encode_container_header(object.children.size(), 0x80, 0xde);
+        for(const auto& [key, value] : object.children) {
+            encode_string(key);
+            encode_value(value);
+        }
+    }
+
+    auto encode_value(const Value& value) -> void {
+        switch(value.get_index()) {
+        case Value::index_of<Number>:
+            encode_number(value.as<Number>().value);
+            break;
+        case Value::index_of<String>:
+            encode_string(value.as<String>().value);
+            break;
+        case Value::index_of<Boolean>:
+            put(value.as<Boolean>().value ? 0xc3 : 0xc2);
+            break;
+        case Value::index_of<Null>:
+            put(0xc0);
+            break;
+        case Value::index_of<Array>: {
+            const auto& array = value.as<Array>().value;
+            encode_container_header(array.size(), 0x90, 0xdc);
+            for(const auto& e : array) {
+                encode_value(e);
+            }
+        } break;
+        case Value::index_of<Object>:
+            encode_object(value.as<Object>());
+            break;
+        }
+    }
+};
+
+struct Decoder {
+    std::span<const std::byte> data;
+    size_t                     cursor = 0;
+
+    auto remaining() const -> size_t {
+        return data.size() - cursor;
+    }
+
+    auto read_bytes(const size_t len) -> std::optional<std::span<const std::byte>> {
+        ensure(len <= remaining());
+        const auto ret = data.subspan(cursor, len);
+        cursor += len;
+        return ret;
+    }
+
+    template <class T>
+    auto read_be() -> std::optional<T> {
+        unwrap(bytes, read_bytes(sizeof(T)));
+        auto value = T(0);
+        for(const auto b : bytes) {
+            value = T(value << 8) | T(b);
+        }
+        return value;
+    }
+
+    auto read_string(const size_t len) -> std::optional<std::string> {
+        unwrap(bytes, read_bytes(len));
+        return std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+
+    template <class T>
+    auto read_length() -> std::optional<size_t> {
+        unwrap(len, read_be<T>());
+        return size_t(len);
+    }
+
+    // T is the wire type, S is the signed reinterpretation if any
+    template <class T, class S = T>
+    auto decode_int() -> std::optional<Value> {
+        unwrap(bits, read_be<T>());
+        return Value::create<Number>(double(S(bits)));
+    }
+
+    template <class T>
+    auto decode_string() -> std::optional<Value> {
+        unwrap(len, read_length<T>());
+        unwrap_mut(str, read_string(len));
+        return Value::create<String>(std::move(str));
+    }
+
+    auto decode_array(const size_t len) -> std::optional<Value> {
+        // every element takes at least one byte
+        ensure(len <= remaining());
+        auto array = Array();
+        array.value.reserve(len);
+        for(auto i = size_t(0); i < len; i += 1) {
+            unwrap_mut(value, decode_value());
+            array.value.push_back(std::move(value));
+        }
+        return Value::create<Array>(std::move(array));
+    }
+
+    auto decode_object(const size_t len) -> std::optional<Value> {
+        // every entry takes at least two bytes
+        ensure(len <= remaining() / 2);
+        auto object = Object();
+        object.children.reserve(len);
+        for(auto i = size_t(0); i < len; i += 1) {
+            unwrap_mut(key, decode_value());
+            unwrap_mut(str, key.get<String>());
+            unwrap_mut(value, decode_value());
+            object.children.push_back({std::move(str.value), std::move(value)});
+        }
+        return Value::create<Object>(std::move(object));
+    }
+
+    auto decode_value() -> std::optional<Value> {
+        unwrap(type, read_be<uint8_t>());
+        if(type <= 0x7f) {
+            return Value::create<Number>(double(type));
+        }
+        if(type >= 0xe0) {
+            return Value::create<Number>(double(int8_t(type)));
+        }
+        if((type & 0xf0) == 0x80) {
+            return decode_object(type & 0x0f);
+        }
+        if((type & 0xf0) == 0x90) {
+            return decode_array(type & 0x0f);
+        }
+        if((type & 0xe0) == 0xa0) {
+            unwrap_mut(str, read_string(type & 0x1f));
+            return Value::create<String>(std::move(str));
+        }
+        switch(type) {
+        case 0xc0:
+            return Value::create<Null>();
+        case 0xc2:
+            return Value::create<Boolean>(false);
+        case 0xc3:
+            return Value::create<Boolean>(true);
+        case 0xca: {
+            unwrap(bits, read_be<uint32_t>());
+            return Value::create<Number>(double(std::bit_cast<float>(bits)));
+        }
+        case 0xcb: {
+            unwrap(bits, read_be<uint64_t>());
+            return Value::create<Number>(std::bit_cast<double>(bits));
+        }
+        case 0xcc:
+            return decode_int<uint8_t>();
+        case 0xcd:
+            return decode_int<uint16_t>();
+        case 0xce:
+            return decode_int<uint32_t>();
+        case 0xcf:
+            return decode_int<uint64_t>();
+        case 0xd0:
+            return decode_int<uint8_t, int8_t>();
+        case 0xd1:
+            return decode_int<uint16_t, int16_t>();
+        case 0xd2:
+            return decode_int<uint32_t, int32_t>();
+        case 0xd3:
+            return decode_int<uint64_t, int64_t>();
+        case 0xd9:
+            return decode_string<uint8_t>();
+        case 0xda:
+            return decode_string<uint16_t>();
+        case 0xdb:
+            return decode_string<uint32_t>();
+        case 0xdc: {
+            unwrap(len, read_length<uint16_t>());
+            return decode_array(len);
+        }
+        case 0xdd: {
+            unwrap(len, read_length<uint32_t>());
+            return decode_array(len);
+        }
+        case 0xde: {
+            unwrap(len, read_length<uint16_t>());
+            return decode_object(len);
+        }
+        case 0xdf: {
+            unwrap(len, read_length<uint32_t>());
+            return decode_object(len);
+        }
+        }
+        bail("unsupported msgpack type {:x}", type);
+    }
+};
+} // namespace
+
+auto encode_msgpack(const Value& value) -> std::vector<std::byte> {
+    auto encoder = Encoder();
+    encoder.encode_value(value);
+    return std::move(encoder.data);
+}
+
+auto encode_msgpack(const Object& object) -> std::vector<std::byte> {
+    auto encoder = Encoder();
+    encoder.encode_object(object);
+    return std::move(encoder.data);
+}
+
+auto decode_msgpack(const std::span<const std::byte> data) -> std::optional<Value> {
+    auto decoder = Decoder{.data = data};
+    unwrap_mut(value, decoder.decode_value());
+    if(decoder.cursor != data.size()) {
+        bail("trailing data at byte {} of {}", decoder.cursor, data.size());
+    }
+    return std::move(value);
+}
+} // namespace json
@@ -1,3 +1,4 @@
+#include <span>
 #include <vector>
 
 #include "json.hpp"
@@ -7,45 +8,41 @@
 namespace json {
 namespace {
 struct Parser {
-    std::vector<Token> tokens;
-    size_t             cursor                = 0;
-    bool               allow_trailing_commas = false;
-
-    template <class T>
-    auto create_value() -> Value {
-        return Value::create<T>();
-    }
+    std::span<Token> tokens;
+    size_t           cursor                = 0;
+    bool             allow_trailing_commas = false;
 
     template <class T, class... Args>
-    auto create_value(Args... args) -> Value {
-        return Value::create<T>(std::forward<Args...>(args...));
+    auto create_value(Args&&... args) -> Value {
+        return Value::create<T>(std::forward<Args>(args)...);
     }
 
-    auto peek() -> const Token* {
+    // tokens are consumed, so returned tokens can be moved from
+    auto peek() -> Token* {
         ensure(cursor < tokens.size());
         return &tokens[cursor];
     }
 
     template <class T>
-    auto peek_type() -> const T* {
-        unwrap(next, peek());
+    auto peek_type() -> T* {
+        unwrap_mut(next, peek());
         return next.get<T>();
     }
 
-    auto read() -> const Token* {
-        unwrap(next, peek());
+    auto read() -> Token* {
+        unwrap_mut(next, peek());
         cursor += 1;
         return &next;
     }
 
     template <class T>
-    auto read_type() -> const T* {
-        unwrap(next, read());
+    auto read_type() -> T* {
+        unwrap_mut(next, read());
         return next.get<T>();
     }
 
     auto parse_value() -> std::optional<Value> {
-        unwrap(token, peek());
+        unwrap_mut(token, peek());
         switch(token.get_index()) {
         case Token::index_of<token::LeftBrace>:
             return parse_object();
@@ -53,7 +50,7 @@ struct Parser {
             return parse_array();
         case Token::index_of<token::String>:
             read();
-            return create_value<String>(token.as<token::String>().value);
+            return create_value<String>(std::move(token.as<token::String>().value));
         case Token::index_of<token::Number>:
             read();
             return create_value<Number>(token.as<token::Number>().value);
@@ -76,10 +73,10 @@ struct Parser {
             return create_value<Object>(std::move(children));
         }
     loop:
-        unwrap(key, read_type<token::String>());
+        unwrap_mut(key, read_type<token::String>());
         ensure(read_type<token::Colon>());
         unwrap_mut(value, parse_value());
-        children.emplace_back(key.value, std::move(value));
+        children.emplace_back(std::move(key.value), std::move(value));
 
         unwrap(next, read());
         switch(next.get_index()) {
@@ -124,9 +121,10 @@ struct Parser {
         }
     }
 
-    auto parse() -> std::optional<Object> {
-        unwrap_mut(value, parse_object());
-        return std::move(value.as<Object>());
+    auto parse() -> std::optional<Value> {
+        unwrap_mut(value, parse_value());
+        ensure(cursor == tokens.size()); // trailing data
+        return std::move(value);
     }
 
     auto get_error() -> std::string {
@@ -135,9 +133,9 @@ struct Parser {
 };
 } // namespace
 
-auto parse(std::vector<Token> tokens, bool allow_trailing_commas) -> std::optional<Object> {
+auto parse_value(const std::span<Token> tokens, const bool allow_trailing_commas) -> std::optional<Value> {
     auto parser = Parser{
-        .tokens                = std::move(tokens),
+        .tokens                = tokens,
         .allow_trailing_commas = allow_trailing_commas,
     };
     auto ret_o = parser.parse();
@@ -148,9 +146,21 @@ auto parse(std::vector<Token> tokens, bool allow_trailing_commas) -> std::option
     }
 }
 
-auto parse(const std::string_view str, ParseOpts opts) -> std::optional<Object> {
-    unwrap_mut(token, tokenize(str, opts.allow_comments));
-    unwrap_mut(object, parse(std::move(token), opts.allow_trailing_commas));
+auto parse(std::vector<Token> tokens, const bool allow_trailing_commas) -> std::optional<Object> {
+    ensure(!tokens.empty() && tokens[0].get<token::LeftBrace>());
+    unwrap_mut(value, parse_value(std::span(tokens), allow_trailing_commas));
+    return std::move(value.as<Object>());
+}
+
+auto parse_value(const std::string_view str, const ParseOpts opts) -> std::optional<Value> {
+    unwrap_mut(tokens, tokenize(str, opts.allow_comments, opts.validate_utf8));
+    unwrap_mut(value, parse_value(std::span(tokens), opts.allow_trailing_commas));
+    return std::move(value);
+}
+
+auto parse(const std::string_view str, const ParseOpts opts) -> std::optional<Object> {
+    unwrap_mut(tokens, tokenize(str, opts.allow_comments, opts.validate_utf8));
+    unwrap_mut(object, parse(std::move(tokens), opts.allow_trailing_commas));
     return std::move(object);
 }
 } // namespace json
@@ -1,7 +1,10 @@
 #pragma once
+#include <span>
+
 #include "json.hpp"
 #include "lexer.hpp"
 
 namespace json {
 auto parse(std::vector<Token> tokens, bool allow_trailing_commas) -> std::optional<Object>;
+auto parse_value(std::span<Token> tokens, bool allow_trailing_commas) -> std::optional<Value>;
 } // namespace json
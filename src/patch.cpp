@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "json.hpp"
+#include "key-index.hpp"
+#include "macros/unwrap.hpp"
+#include "util/charconv.hpp"
+
+namespace json {
+namespace {
+// json pointer (RFC 6901)
+auto append_pointer_token(std::string& path, const std::string_view token) -> void {
+    path += '/';
+    for(const auto c : token) {
+        switch(c) {
+        case '~':
+            path += "~0";
+            break;
+        case '/':
+            path += "~1";
+            break;
+        default:
+            path += c;
+            break;
+        }
+    }
+}
+
+auto split_pointer(const std::string_view path) -> std::optional<std::vector<std::string>> {
+    auto tokens = std::vector<std::string>();
+    if(path.empty()) {
+        return tokens;
+    }
+    ensure(path[0] == '/');
+    for(auto i = size_t(1); i <= path.size(); i += 1) {
+        if(i == 1 || path[i - 1] == '/') {
+            tokens.emplace_back();
+        }
+        if(i == path.size() || path[i] == '/') {
+            continue;
+        }
+        if(path[i] != '~') {
+            tokens.back() += path[i];
+            continue;
+        }
+        ensure(i + 1 < path.size());
+        i += 1;
+        if(path[i] == '0') {
+            tokens.back() += '~';
+        } else if(path[i] == '1') {
+            tokens.back() += '/';
+        } else {
+            bail("invalid escape in json pointer {}", path);
+        }
+    }
+    return tokens;
+}
+
+// index must be in [0, size], end is allowed only for insertion
+auto parse_index(const std::string_view token, const size_t size, const bool allow_end) -> std::optional<size_t> {
+    if(allow_end && token == "-") {
+        return size;
+    }
+    ensure(!token.empty() && (token == "0" || token[0] != '0'));
+    for(const auto c : token) {
+        ensure(c >= '0' && c <= '9');
+    }
+    unwrap(index, from_chars<size_t>(token));
+    ensure(index < size || (allow_end && index == size));
+    return index;
+}
+
+// the container which holds the value pointed by the last token
+struct Parent {
+    Object* object = nullptr;
+    Array*  array  = nullptr;
+
+    auto find(const std::string_view token) -> Value* {
+        if(object) {
+            return object->find(token);
+        }
+        unwrap(index, parse_index(token, array->value.size(), false));
+        return &array->value[index];
+    }
+
+    auto add(const std::string_view token, Value value) -> bool {
+        if(object) {
+            (*object)[token] = std::move(value);
+            return true;
+        }
+        unwrap(index, parse_index(token, array->value.size(), true));
+        array->value.insert(array->value.begin() + index, std::move(value));
+        return true;
+    }
+
+    auto remove(const std::string_view token) -> std::optional<Value> {
+        if(object) {
+            auto& children = object->children;
+            for(auto i = children.begin(); i != children.end(); i = std::next(i)) {
+                if(i->key == token) {
+                    auto value = std::move(i->value);
+                    children.erase(i);
+                    return value;
+                }
+            }
+            bail("no such key {}", token);
+        }
+        unwrap(index, parse_index(token, array->value.size(), false));
+        auto value = std::move(array->value[index]);
+        array->value.erase(array->value.begin() + index);
+        return value;
+    }
+};
+
+auto resolve_parent(Object& root, const std::span<const std::string> tokens) -> std::optional<Parent> {
+    auto parent = Parent{.object = &root};
+    for(const auto& token : tokens.first(tokens.size() - 1)) {
+        unwrap_mut(value, parent.find(token));
+        if(const auto object = value.get<Object>()) {
+            parent = Parent{.object = object};
+        } else if(const auto array = value.get<Array>()) {
+            parent = Parent{.array = array};
+        } else {
+            bail("{} is not a container", token);
+        }
+    }
+    return parent;
+}
+
+struct Patcher {
+    Object& root;
+
+    auto get(const std::span<const std::string> pointer) -> Value* {
+        ensure(!pointer.empty());
+        unwrap_mut(parent, resolve_parent(root, pointer));
+        return parent.find(pointer.back());
+    }
+
+    auto add(const std::span<const std::string> pointer, Value value) -> bool {
+        if(pointer.empty()) {
+            unwrap_mut(object, value.get<Object>());
+            root = std::move(object);
+            return true;
+        }
+        unwrap_mut(parent, resolve_parent(root, pointer));
+        return parent.add(pointer.back(), std::move(value));
+    }
+
+    auto remove(const std::span<const std::string> pointer) -> std::optional<Value> {
+        ensure(!pointer.empty());
+        unwrap_mut(parent, resolve_parent(root, pointer));
+        return parent.remove(pointer.back());
+    }
+
+    auto apply(const Object& operation) -> bool {
+        unwrap(op, operation.find<String>("op"));
+        unwrap(path_str, operation.find<String>("path"));
+        unwrap(path, split_pointer(path_str.value));
+
+        const auto& name = op.value;
+        if(name == "add" || name == "replace" || name == "test") {
+            unwrap(value, operation.find("value"));
+            if(name == "add") {
+                return add(path, value);
+            }
+            if(path.empty()) {
+                unwrap(object, value.get<Object>());
+                if(name == "test") {
+                    return root == object;
+                }
+                root = object;
+                return true;
+            }
+            unwrap_mut(target, get(path));
+            if(name == "test") {
+                return target == value;
+            }
+            target = value;
+            return true;
+        }
+        if(name == "remove") {
+            return remove(path).has_value();
+        }
+        if(name == "move" || name == "copy") {
+            unwrap(from_str, operation.find<String>("from"));
+            unwrap(from, split_pointer(from_str.value));
+            if(name == "copy") {
+                unwrap(value, get(from));
+                return add(path, Value(value));
+            }
+            if(from == path) {
+                // nothing to move, but from must exist
+                return get(from) != nullptr;
+            }
+            // cannot move a value into its own child
+            const auto is_prefix = from.size() < path.size() && std::equal(from.begin(), from.end(), path.begin());
+            ensure(!is_prefix);
+            unwrap_mut(value, remove(from));
+            return add(path, std::move(value));
+        }
+        bail("unknown operation {}", name);
+    }
+};
+
+struct Differ {
+    Array       patch;
+    std::string path;
+
+    auto push(const std::string_view op, const Value* value) -> void {
+        auto operation = Object();
+        operation.children.reserve(value ? 3 : 2);
+        operation.children.emplace_back("op", Value::create<String>(std::string(op)));
+        operation.children.emplace_back("path", Value::create<String>(path));
+        if(value) {
+            operation.children.emplace_back("value", *value);
+        }
+        patch.value.push_back(Value::create<Object>(std::move(operation)));
+    }
+
+    // runs fn with token appended to the current path
+    template <class Fn>
+    auto with_token(const std::string_view token, Fn fn) -> void {
+        const auto len = path.size();
+        append_pointer_token(path, token);
+        fn();
+        path.resize(len);
+    }
+
+    auto diff_value(const Value& from, const Value& to) -> void {
+        if(from.get_index() == to.get_index()) {
+            if(const auto object = from.get<Object>()) {
+                diff_object(*object, to.as<Object>());
+                return;
+            }
+            if(const auto array = from.get<Array>()) {
+                diff_array(*array, to.as<Array>());
+                return;
+            }
+        }
+        if(!(from == to)) {
+            push("replace", &to);
+        }
+    }
+
+    auto diff_object(const Object& from, const Object& to) -> void {
+        const auto from_index = impl::make_key_index(from);
+        const auto to_index   = impl::make_key_index(to);
+        for(const auto& [key, value] : from.children) {
+            if(!to_index.find(key)) {
+                with_token(key, [&] { push("remove", nullptr); });
+            }
+        }
+        for(const auto& [key, value] : to.children) {
+            const auto p = from_index.find(key);
+            with_token(key, [&] {
+                if(p) {
+                    diff_value(*p, value);
+                } else {
+                    push("add", &value);
+                }
+            });
+        }
+    }
+
+    auto diff_array(const Array& from, const Array& to) -> void {
+        const auto& a = from.value;
+        const auto& b = to.value;
+
+        // skip common head and tail, so that a single insertion or removal becomes a single operation
+        auto head = size_t(0);
+        while(head < a.size() && head < b.size() && a[head] == b[head]) {
+            head += 1;
+        }
+        auto tail = size_t(0);
+        while(tail < a.size() - head && tail < b.size() - head && a[a.size() - 1 - tail] == b[b.size() - 1 - tail]) {
+            tail += 1;
+        }
+        const auto a_len = a.size() - head - tail;
+        const auto b_len = b.size() - head - tail;
+
+        const auto common = std::min(a_len, b_len);
+        for(auto i = head; i < head + common; i += 1) {
+            with_token(std::to_string(i), [&] { diff_value(a[i], b[i]); });
+        }
+        for(auto i = head + common; i < head + b_len; i += 1) {
+            with_token(std::to_string(i), [&] { push("add", &b[i]); });
+        }
+        for(auto i = head + a_len; i > head + common; i -= 1) {
+            with_token(std::to_string(i - 1), [&] { push("remove", nullptr); });
+        }
+    }
+};
+} // namespace
+
+auto diff(const Object& from, const Object& to) -> Array {
+    auto differ = Differ();
+    differ.diff_object(from, to);
+    return std::move(differ.patch);
+}
+
+auto apply_patch(Object& object, const Array& patch) -> bool {
+    auto patcher = Patcher{object};
+    for(auto i = 0u; i < patch.value.size(); i += 1) {
+        unwrap(operation, patch.value[i].get<Object>());
+        if(!patcher.apply(operation)) {
+            bail("patch operation {} failed", i);
+        }
+    }
+    return true;
+}
+} // namespace json
@@ -0,0 +1,17 @@
+#include "lexer.hpp"
+#include "macros/unwrap.hpp"
+#include "parser.hpp"
+#include "reader.hpp"
+
+namespace json {
+auto Reader::is_eof() -> bool {
+    return skip_blank(str, cursor, opts.allow_comments) && cursor >= str.size();
+}
+
+auto Reader::read() -> std::optional<Value> {
+    tokens.clear();
+    ensure(tokenize_value(str, cursor, opts.allow_comments, opts.validate_utf8, tokens));
+    unwrap_mut(value, parse_value(std::span(tokens), opts.allow_trailing_commas));
+    return std::move(value);
+}
+} // namespace json
@@ -0,0 +1,19 @@
+#pragma once
+#include <vector>
+
+#include "json.hpp"
+#include "lexer.hpp"
+
+namespace json {
+// reads concatenated values from str one at a time
+struct Reader {
+    std::string_view   str;
+    ParseOpts          opts   = {};
+    size_t             cursor = 0;
+    std::vector<Token> tokens = {}; // reused between values
+
+    // skips blanks and returns true if no value remains
+    auto is_eof() -> bool;
+    auto read() -> std::optional<Value>;
+};
+} // namespace json
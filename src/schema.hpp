@@ -0,0 +1,395 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <bitset>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.hpp"
+#include "lexer.hpp"
+#include "macros/unwrap.hpp"
+#include "parser.hpp"
+#include "util/charconv.hpp"
+
+// parsers specialized for a fixed C++ struct
+//
+// struct Point { double x; double y; };
+// struct Shape { std::string name; std::vector<Point> points; std::optional<bool> closed; };
+// using PointSchema = Schema<Point, Field<"x", &Point::x>, Field<"y", &Point::y>>;
+// using ShapeSchema = Schema<Shape, Field<"name", &Shape::name>, Field<"points", &Shape::points, PointSchema>, Field<"closed", &Shape::closed>>;
+// auto shape = parse<ShapeSchema>(str);
+//
+// supported member types are bool, arithmetic types, std::string, Value, std::optional and std::vector of them,
+// and structs described by another schema
+// std::optional members may be missing or null, every other member is required
+// unknown keys, duplicated keys and mistyped values are errors
+namespace json::schema {
+template <size_t N>
+struct FixedString {
+    char data[N];
+
+    constexpr FixedString(const char (&str)[N]) {
+        std::copy_n(str, N, data);
+    }
+
+    constexpr auto view() const -> std::string_view {
+        return std::string_view(data, N - 1);
+    }
+};
+
+namespace impl {
+template <class T>
+constexpr auto is_optional = false;
+
+template <class T>
+constexpr auto is_optional<std::optional<T>> = true;
+
+template <class T>
+constexpr auto is_vector = false;
+
+template <class T>
+constexpr auto is_vector<std::vector<T>> = true;
+
+template <class T>
+struct MemberPointer;
+
+template <class C, class M>
+struct MemberPointer<M C::*> {
+    using Class  = C;
+    using Member = M;
+};
+
+constexpr auto hash(const std::string_view key, const uint32_t seed) -> uint32_t {
+    // fnv-1a with a final mix for the low bits
+    auto h = uint32_t(2166136261u) ^ seed;
+    for(const auto c : key) {
+        h ^= uint8_t(c);
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+constexpr auto max_seed_trials = 4096u;
+
+// returns the seed which maps every name to a distinct slot, or nullopt
+template <size_t N>
+constexpr auto find_seed(const std::array<std::string_view, N>& names, const size_t table_size) -> std::optional<uint32_t> {
+    for(auto seed = 0u; seed < max_seed_trials; seed += 1) {
+        auto used = std::vector<bool>(table_size);
+        auto ok   = true;
+        for(const auto name : names) {
+            const auto slot = hash(name, seed) & (table_size - 1);
+            if(used[slot]) {
+                ok = false;
+                break;
+            }
+            used[slot] = true;
+        }
+        if(ok) {
+            return seed;
+        }
+    }
+    return std::nullopt;
+}
+
+template <size_t N>
+constexpr auto find_table_size(const std::array<std::string_view, N>& names) -> size_t {
+    auto size = std::bit_ceil(std::max(N, size_t(1))) * 2;
+    while(!find_seed(names, size)) {
+        size *= 2;
+    }
+    return size;
+}
+
+// perfect hash table from key to field index
+template <size_t N, size_t table_size>
+struct KeyTable {
+    static constexpr auto none = uint16_t(-1);
+
+    std::array<std::string_view, N>  names;
+    std::array<uint16_t, table_size> slots;
+    uint32_t                         seed;
+
+    constexpr KeyTable(const std::array<std::string_view, N>& names)
+        : names(names),
+          slots(),
+          seed(*find_seed(names, table_size)) {
+        static_assert(N < none);
+        slots.fill(none);
+        for(auto i = 0u; i < N; i += 1) {
+            slots[hash(names[i], seed) & (table_size - 1)] = i;
+        }
+    }
+
+    // returns -1 for unknown keys
+    constexpr auto find(const std::string_view key) const -> int {
+        const auto index = slots[hash(key, seed) & (table_size - 1)];
+        return index != none && names[index] == key ? index : -1;
+    }
+};
+
+struct Context {
+    std::string_view   str;
+    ParseOpts          opts;
+    size_t             cursor  = 0;
+    std::string        scratch = {}; // keys with escape sequences
+    std::vector<Token> tokens  = {}; // for Value members
+
+    auto skip_blank() -> bool {
+        while(cursor < str.size()) {
+            const auto c = str[cursor];
+            if(c == ' ' || c == '\n' || c == '\t') {
+                cursor += 1;
+            } else if(c == '\r' || (c == '/' && opts.allow_comments)) {
+                // let the lexer decide, it accepts \r only before \n
+                ensure(json::skip_blank(str, cursor, opts.allow_comments));
+            } else {
+                break;
+            }
+        }
+        return true;
+    }
+
+    auto peek() -> std::optional<char> {
+        ensure(skip_blank());
+        ensure(cursor < str.size());
+        return str[cursor];
+    }
+
+    auto consume(const char expect) -> bool {
+        unwrap(next, peek());
+        ensure(next == expect);
+        cursor += 1;
+        return true;
+    }
+
+    // consumes expect if it is the next character
+    auto try_consume(const char expect) -> bool {
+        const auto next = peek();
+        if(next == expect) {
+            cursor += 1;
+            return true;
+        }
+        return false;
+    }
+
+    auto read_literal(const std::string_view literal) -> bool {
+        ensure(str.substr(cursor, literal.size()) == literal);
+        cursor += literal.size();
+        return true;
+    }
+
+    auto read_string(std::string& out) -> bool {
+        unwrap(next, peek());
+        ensure(next == '"');
+        auto reader   = StringReader{str};
+        reader.cursor = cursor;
+        out.clear();
+        ensure(decode_string(reader, opts.validate_utf8, out));
+        cursor = reader.cursor;
+        return true;
+    }
+
+    // keys without escape sequences are returned in place
+    // others are decoded into scratch, so the returned view is valid only until the next read_key
+    auto read_key() -> std::optional<std::string_view> {
+        unwrap(next, peek());
+        ensure(next == '"');
+        const auto end = str.find_first_of("\"\\", cursor + 1);
+        ensure(end != str.npos);
+        if(str[end] == '"') {
+            const auto key = str.substr(cursor + 1, end - cursor - 1);
+            cursor         = end + 1;
+            return key;
+        }
+        ensure(read_string(scratch));
+        return std::string_view(scratch);
+    }
+
+    auto read_number() -> std::optional<std::string_view> {
+        ensure(skip_blank());
+        const auto begin = cursor;
+        while(cursor < str.size()) {
+            const auto c = str[cursor];
+            if(!(c >= '0' && c <= '9') && c != '+' && c != '-' && c != '.' && c != 'e' && c != 'E') {
+                break;
+            }
+            cursor += 1;
+        }
+        if(cursor == begin) {
+            bail("expected number");
+        }
+        return str.substr(begin, cursor - begin);
+    }
+
+    template <class S>
+    auto read_object(typename S::Type& out) -> bool;
+
+    template <class M, class S>
+    auto read(M& out) -> bool {
+        if constexpr(std::is_same_v<M, bool>) {
+            unwrap(next, peek());
+            if(next == 't') {
+                ensure(read_literal("true"));
+                out = true;
+            } else if(next == 'f') {
+                ensure(read_literal("false"));
+                out = false;
+            } else {
+                bail("expected boolean");
+            }
+        } else if constexpr(std::is_floating_point_v<M>) {
+            unwrap(num, read_number());
+            unwrap(value, from_chars<double>(num));
+            out = M(value);
+        } else if constexpr(std::is_integral_v<M>) {
+            unwrap(num, read_number());
+            if(const auto value = from_chars<M>(num)) {
+                out = *value;
+                return true;
+            }
+            // forms like 1.0 or 1e3
+            unwrap(value, from_chars<double>(num));
+            ensure(value == std::trunc(value));
+            // max + 1 is a power of two and exact in double, unlike max itself for 64-bit types
+            ensure(value >= double(std::numeric_limits<M>::min()) && value < std::ldexp(1.0, std::numeric_limits<M>::digits));
+            out = M(value);
+        } else if constexpr(std::is_same_v<M, std::string>) {
+            ensure(read_string(out));
+        } else if constexpr(std::is_same_v<M, Value>) {
+            tokens.clear();
+            ensure(tokenize_value(str, cursor, opts.allow_comments, opts.validate_utf8, tokens));
+            unwrap_mut(value, parse_value(std::span(tokens), opts.allow_trailing_commas));
+            out = std::move(value);
+        } else if constexpr(is_optional<M>) {
+            unwrap(next, peek());
+            if(next == 'n') {
+                ensure(read_literal("null"));
+                out.reset();
+            } else {
+                ensure((read<typename M::value_type, S>(out ? *out : out.emplace())));
+            }
+        } else if constexpr(is_vector<M>) {
+            ensure(consume('['));
+            out.clear();
+            if(try_consume(']')) {
+                return true;
+            }
+            while(true) {
+                ensure((read<typename M::value_type, S>(out.emplace_back())));
+                if(try_consume(']')) {
+                    break;
+                }
+                ensure(consume(','));
+                if(opts.allow_trailing_commas && try_consume(']')) {
+                    break;
+                }
+            }
+        } else {
+            static_assert(!std::is_void_v<S>, "struct members need a schema");
+            static_assert(std::is_same_v<M, typename S::Type>, "schema does not describe the member type");
+            ensure(read_object<S>(out));
+        }
+        return true;
+    }
+};
+} // namespace impl
+
+// Schema describes the member type if it is a struct or a container of structs
+template <FixedString key, auto member, class Schema = void>
+struct Field {
+    using Member = typename impl::MemberPointer<decltype(member)>::Member;
+
+    static constexpr auto name     = key.view();
+    static constexpr auto required = !impl::is_optional<Member>;
+
+    template <class T>
+    static auto parse(impl::Context& context, T& object) -> bool {
+        return context.read<Member, Schema>(object.*member);
+    }
+
+    template <class T>
+    static auto reset(T& object) -> void {
+        if constexpr(!required) {
+            (object.*member).reset();
+        }
+    }
+};
+
+template <class T, class... Fields>
+struct Schema {
+    using Type = T;
+
+    static constexpr auto size      = sizeof...(Fields);
+    static constexpr auto names     = std::array<std::string_view, size>{Fields::name...};
+    static constexpr auto keys      = impl::KeyTable<size, impl::find_table_size(names)>(names);
+    static constexpr auto required  = std::array<bool, size>{Fields::required...};
+    static constexpr auto parsers   = std::array<bool (*)(impl::Context&, T&), size>{&Fields::template parse<T>...};
+    static constexpr auto resetters = std::array<void (*)(T&), size>{&Fields::template reset<T>...};
+};
+
+template <class S>
+auto impl::Context::read_object(typename S::Type& out) -> bool {
+    ensure(consume('{'));
+    auto seen = std::bitset<S::size>();
+    if(!try_consume('}')) {
+        while(true) {
+            unwrap(key, read_key());
+            const auto index = S::keys.find(key);
+            if(index < 0) {
+                bail("unknown field {}", key);
+            }
+            if(seen[index]) {
+                bail("duplicated field {}", S::names[index]);
+            }
+            seen[index] = true;
+            ensure(consume(':'));
+            // key may be overwritten by nested objects, name the field from the schema
+            if(!S::parsers[index](*this, out)) {
+                bail("invalid value for field {}", S::names[index]);
+            }
+            if(try_consume('}')) {
+                break;
+            }
+            ensure(consume(','));
+            if(opts.allow_trailing_commas && try_consume('}')) {
+                break;
+            }
+        }
+    }
+    for(auto i = 0u; i < S::size; i += 1) {
+        if(seen[i]) {
+            continue;
+        }
+        if(S::required[i]) {
+            bail("missing field {}", S::names[i]);
+        }
+        // clear stale values left in out
+        S::resetters[i](out);
+    }
+    return true;
+}
+
+// parses into out, reusing the capacity of its strings and vectors
+// out is left partially updated on failure
+template <class S>
+auto parse(const std::string_view str, typename S::Type& out, const ParseOpts opts = {}) -> bool {
+    auto context = impl::Context{.str = str, .opts = opts};
+    ensure(context.read_object<S>(out));
+    ensure(context.skip_blank());
+    ensure(context.cursor == str.size()); // trailing data
+    return true;
+}
+
+template <class S>
+auto parse(const std::string_view str, const ParseOpts opts = {}) -> std::optional<typename S::Type> {
+    auto out = typename S::Type();
+    ensure(parse<S>(str, out, opts));
+    return out;
+}
+} // namespace json::schema
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "macros/unwrap.hpp"
+#include "snapshot.hpp"
+
+namespace json::snapshot {
+namespace {
+// slot types are stored on disk, do not reorder Value's alternatives
+static_assert(Value::index_of<Number> == 0);
+static_assert(Value::index_of<String> == 1);
+static_assert(Value::index_of<Boolean> == 2);
+static_assert(Value::index_of<Null> == 3);
+static_assert(Value::index_of<Array> == 4);
+static_assert(Value::index_of<Object> == 5);
+
+constexpr auto align = size_t(8);
+
+struct Writer {
+    std::vector<std::byte>                         nodes;
+    std::vector<std::byte>                         pool;
+    std::unordered_map<std::string_view, uint64_t> strings; // deduplicates keys and values
+
+    // returns an image offset
+    auto alloc_node(const size_t size) -> uint64_t {
+        const auto offset = sizeof(Header) + nodes.size();
+        nodes.resize(nodes.size() + size);
+        return offset;
+    }
+
+    template <class T>
+    auto store(const uint64_t offset, const T& value) -> void {
+        std::memcpy(nodes.data() + offset - sizeof(Header), &value, sizeof(T));
+    }
+
+    // returns a pool offset
+    auto intern(const std::string_view str) -> uint64_t {
+        if(const auto i = strings.find(str); i != strings.end()) {
+            return i->second;
+        }
+        const auto offset = uint64_t(pool.size());
+        const auto len    = uint64_t(str.size());
+        const auto size   = (sizeof(len) + str.size() + align - 1) / align * align;
+        pool.resize(pool.size() + size);
+        std::memcpy(pool.data() + offset, &len, sizeof(len));
+        std::memcpy(pool.data() + offset + sizeof(len), str.data(), str.size());
+        strings.emplace(str, offset);
+        return offset;
+    }
+
+    auto write_value(const Value& value) -> Slot {
+        auto slot = Slot{.type = uint32_t(value.get_index()), .reserved = 0, .payload = 0};
+        switch(value.get_index()) {
+        case Value::index_of<Number>:
+            std::memcpy(&slot.payload, &value.as<Number>().value, sizeof(slot.payload));
+            break;
+        case Value::index_of<String>:
+            slot.payload = intern(value.as<String>().value);
+            break;
+        case Value::index_of<Boolean>:
+            slot.payload = value.as<Boolean>().value ? 1 : 0;
+            break;
+        case Value::index_of<Null>:
+            break;
+        case Value::index_of<Array>:
+            slot.payload = write_array(value.as<Array>());
+            break;
+        case Value::index_of<Object>:
+            slot.payload = write_object(value.as<Object>());
+            break;
+        }
+        return slot;
+    }
+
+    auto write_array(const Array& array) -> uint64_t {
+        const auto& values = array.value;
+        const auto  node   = alloc_node(sizeof(uint64_t) + sizeof(Slot) * values.size());
+        store(node, uint64_t(values.size()));
+        for(auto i = 0u; i < values.size(); i += 1) {
+            store(node + sizeof(uint64_t) + sizeof(Slot) * i, write_value(values[i]));
+        }
+        return node;
+    }
+
+    auto write_object(const Object& object) -> uint64_t {
+        const auto& children = object.children;
+        const auto  node     = alloc_node(sizeof(uint64_t) + sizeof(Entry) * children.size());
+        store(node, uint64_t(children.size()));
+
+        // stable, so that lookup finds the first of duplicated keys as Object::find does
+        auto order = std::vector<const Object::KeyValue*>(children.size());
+        std::ranges::transform(children, order.begin(), [](const auto& c) { return &c; });
+        std::ranges::stable_sort(order, {}, &Object::KeyValue::key);
+
+        for(auto i = 0u; i < order.size(); i += 1) {
+            const auto entry = Entry{.key = intern(order[i]->key), .value = write_value(order[i]->value)};
+            store(node + sizeof(uint64_t) + sizeof(Entry) * i, entry);
+        }
+        return node;
+    }
+};
+
+auto check_header(const std::span<const std::byte> image) -> bool {
+    ensure(image.size() >= sizeof(Header));
+    ensure(reinterpret_cast<uintptr_t>(image.data()) % align == 0);
+    const auto& header = *reinterpret_cast<const Header*>(image.data());
+    ensure(header.magic == magic);
+    ensure(header.size == image.size());
+    ensure(header.root >= sizeof(Header) && header.root < header.pool && header.pool <= header.size);
+    return true;
+}
+} // namespace
+
+auto ValueView::to_value() const -> Value {
+    switch(get_index()) {
+    case Value::index_of<Number>:
+        return Value::create<Number>(as_number());
+    case Value::index_of<String>:
+        return Value::create<String>(std::string(as_string()));
+    case Value::index_of<Boolean>:
+        return Value::create<Boolean>(as_boolean());
+    case Value::index_of<Array>:
+        return Value::create<Array>(as_array().to_array());
+    case Value::index_of<Object>:
+        return Value::create<Object>(as_object().to_object());
+    default:
+        return Value::create<Null>();
+    }
+}
+
+auto ArrayView::to_array() const -> Array {
+    auto array = Array();
+    array.value.reserve(size());
+    for(auto i = size_t(0); i < size(); i += 1) {
+        array.value.push_back((*this)[i].to_value());
+    }
+    return array;
+}
+
+auto ObjectView::find(const std::string_view key) const -> std::optional<ValueView> {
+    auto begin = size_t(0);
+    auto end   = size();
+    while(begin < end) {
+        const auto mid = begin + (end - begin) / 2;
+        if(this->key(mid) < key) {
+            begin = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+    if(begin == size() || this->key(begin) != key) {
+        return std::nullopt;
+    }
+    return value(begin);
+}
+
+auto ObjectView::to_object() const -> Object {
+    auto object = Object();
+    object.children.reserve(size());
+    for(auto i = size_t(0); i < size(); i += 1) {
+        object.children.push_back({std::string(key(i)), value(i).to_value()});
+    }
+    return object;
+}
+
+auto write(const Object& object) -> std::vector<std::byte> {
+    auto       writer = Writer();
+    const auto root   = writer.write_object(object);
+
+    const auto header = Header{
+        .magic = magic,
+        .size  = sizeof(Header) + writer.nodes.size() + writer.pool.size(),
+        .root  = root,
+        .pool  = sizeof(Header) + writer.nodes.size(),
+    };
+    auto image = std::vector<std::byte>(header.size);
+    std::memcpy(image.data(), &header, sizeof(Header));
+    std::ranges::copy(writer.nodes, image.begin() + sizeof(Header));
+    std::ranges::copy(writer.pool, image.begin() + header.pool);
+    return image;
+}
+
+auto save(const Object& object, const char* const path) -> bool {
+    const auto image = write(object);
+    const auto file  = fopen(path, "wb");
+    ensure(file != nullptr);
+    const auto written = fwrite(image.data(), 1, image.size(), file);
+    ensure(fclose(file) == 0);
+    ensure(written == image.size());
+    return true;
+}
+
+auto open_image(const std::span<const std::byte> image) -> std::optional<ObjectView> {
+    ensure(check_header(image));
+    const auto& header = *reinterpret_cast<const Header*>(image.data());
+    return ObjectView{image.data(), reinterpret_cast<const uint64_t*>(image.data() + header.root)};
+}
+
+Snapshot::Snapshot(Snapshot&& other)
+    : image(std::exchange(other.image, {})) {
+}
+
+auto Snapshot::operator=(Snapshot&& other) -> Snapshot& {
+    std::swap(image, other.image);
+    return *this;
+}
+
+Snapshot::~Snapshot() {
+    if(!image.empty()) {
+        munmap(const_cast<std::byte*>(image.data()), image.size());
+    }
+}
+
+auto load(const char* const path) -> std::optional<Snapshot> {
+    const auto fd = open(path, O_RDONLY);
+    ensure(fd >= 0);
+    struct stat st       = {};
+    const auto  stat_ret = fstat(fd, &st);
+    const auto  addr     = stat_ret == 0 && st.st_size > 0 ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    ensure(addr != MAP_FAILED);
+
+    auto snapshot  = Snapshot();
+    snapshot.image = std::span(static_cast<const std::byte*>(addr), size_t(st.st_size));
+    ensure(check_header(snapshot.image));
+    return snapshot;
+}
+} // namespace json::snapshot
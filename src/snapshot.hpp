@@ -0,0 +1,158 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "json.hpp"
+
+// position independent image of an Object tree, readable in place
+// all offsets are relative to the image head, integers are native endian
+namespace json::snapshot {
+constexpr auto magic = std::array<char, 8>{'t', 'j', 's', 'n', 'a', 'p', '0', '1'};
+
+struct Header {
+    std::array<char, 8> magic;
+    uint64_t            size; // image size in bytes
+    uint64_t            root; // offset of the root object node
+    uint64_t            pool; // offset of the string pool
+};
+
+// type is Value's index, payload depends on type:
+// Number: the bits of the double
+// String: offset of the string in the pool, the string is prefixed by uint64_t length
+// Boolean: 0 or 1
+// Array: offset of the array node, uint64_t count followed by Slot[count]
+// Object: offset of the object node, uint64_t count followed by Entry[count] sorted by key
+struct Slot {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t payload;
+};
+
+struct Entry {
+    uint64_t key; // offset of the string in the pool
+    Slot     value;
+};
+
+struct ArrayView;
+struct ObjectView;
+
+struct ValueView {
+    const std::byte* image;
+    const Slot*      slot;
+
+    auto get_index() const -> size_t {
+        return slot->type;
+    }
+
+    auto as_number() const -> double;
+    auto as_string() const -> std::string_view;
+    auto as_boolean() const -> bool;
+    auto as_array() const -> ArrayView;
+    auto as_object() const -> ObjectView;
+    // deep copies into a mutable tree
+    auto to_value() const -> Value;
+};
+
+struct ArrayView {
+    const std::byte* image;
+    const uint64_t*  node;
+
+    auto size() const -> size_t {
+        return node[0];
+    }
+
+    auto operator[](const size_t index) const -> ValueView {
+        return ValueView{image, reinterpret_cast<const Slot*>(node + 1) + index};
+    }
+
+    auto to_array() const -> Array;
+};
+
+struct ObjectView {
+    const std::byte* image;
+    const uint64_t*  node;
+
+    auto size() const -> size_t {
+        return node[0];
+    }
+
+    auto entry(const size_t index) const -> const Entry& {
+        return reinterpret_cast<const Entry*>(node + 1)[index];
+    }
+
+    // entries are ordered by key
+    auto key(size_t index) const -> std::string_view;
+
+    auto value(const size_t index) const -> ValueView {
+        return ValueView{image, &entry(index).value};
+    }
+
+    // binary search over the sorted key table
+    auto find(std::string_view key) const -> std::optional<ValueView>;
+
+    auto to_object() const -> Object;
+};
+
+inline auto read_pool_string(const std::byte* const image, const uint64_t offset) -> std::string_view {
+    const auto& header = *reinterpret_cast<const Header*>(image);
+    const auto  ptr    = image + header.pool + offset;
+    auto        len    = uint64_t();
+    std::memcpy(&len, ptr, sizeof(len));
+    return std::string_view(reinterpret_cast<const char*>(ptr + sizeof(len)), len);
+}
+
+inline auto ValueView::as_number() const -> double {
+    auto value = double();
+    std::memcpy(&value, &slot->payload, sizeof(value));
+    return value;
+}
+
+inline auto ValueView::as_string() const -> std::string_view {
+    return read_pool_string(image, slot->payload);
+}
+
+inline auto ValueView::as_boolean() const -> bool {
+    return slot->payload != 0;
+}
+
+inline auto ValueView::as_array() const -> ArrayView {
+    return ArrayView{image, reinterpret_cast<const uint64_t*>(image + slot->payload)};
+}
+
+inline auto ValueView::as_object() const -> ObjectView {
+    return ObjectView{image, reinterpret_cast<const uint64_t*>(image + slot->payload)};
+}
+
+inline auto ObjectView::key(const size_t index) const -> std::string_view {
+    return read_pool_string(image, entry(index).key);
+}
+
+// serializes object into an image
+auto write(const Object& object) -> std::vector<std::byte>;
+auto save(const Object& object, const char* path) -> bool;
+
+// checks the header only, contents of the image are trusted
+// image must be 8-byte aligned and outlive the view
+auto open_image(std::span<const std::byte> image) -> std::optional<ObjectView>;
+
+// read-only memory mapped image
+struct Snapshot {
+    std::span<const std::byte> image;
+
+    auto root() const -> ObjectView {
+        return ObjectView{image.data(), reinterpret_cast<const uint64_t*>(image.data() + reinterpret_cast<const Header*>(image.data())->root)};
+    }
+
+    Snapshot() = default;
+    Snapshot(Snapshot&& other);
+    auto operator=(Snapshot&& other) -> Snapshot&;
+    ~Snapshot();
+};
+
+auto load(const char* path) -> std::optional<Snapshot>;
+} // namespace json::snapshot
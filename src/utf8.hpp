@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace json {
+struct Utf8Sequence {
+    uint32_t code;
+    uint32_t len;
+};
+
+// decodes the multi-byte sequence at str[i]
+// overlong forms, surrogates and code points beyond U+10FFFF are invalid
+inline auto utf8_sequence(const std::string_view str, const size_t i) -> std::optional<Utf8Sequence> {
+    const auto at   = [&str](const size_t i) -> uint8_t { return i < str.size() ? str[i] : 0; };
+    const auto lead = at(i);
+
+    // the second byte has a narrower range for some leading bytes
+    auto len = uint32_t(0);
+    auto min = uint8_t(0x80);
+    auto max = uint8_t(0xbf);
+    if(lead >= 0xc2 && lead <= 0xdf) {
+        len = 2;
+    } else if(lead >= 0xe0 && lead <= 0xef) {
+        len = 3;
+        min = lead == 0xe0 ? 0xa0 : min;
+        max = lead == 0xed ? 0x9f : max;
+    } else if(lead >= 0xf0 && lead <= 0xf4) {
+        len = 4;
+        min = lead == 0xf0 ? 0x90 : min;
+        max = lead == 0xf4 ? 0x8f : max;
+    } else {
+        return std::nullopt;
+    }
+    if(at(i + 1) < min || at(i + 1) > max) {
+        return std::nullopt;
+    }
+    auto code = uint32_t(lead & (0x7f >> len));
+    for(auto n = uint32_t(1); n < len; n += 1) {
+        const auto c = at(i + n);
+        if(c < 0x80 || c > 0xbf) {
+            return std::nullopt;
+        }
+        code = (code << 6) | (c & 0x3f);
+    }
+    return Utf8Sequence{code, len};
+}
+} // namespace json